@@ -0,0 +1,131 @@
+/*! @file
+ *
+ *  @brief Atomic operations for sharing data between interrupts and the main loop.
+ *
+ *  This contains lock-free read-modify-write operations on 8, 16 and 32-bit values:
+ *    Atomic_FetchAddN(address, value)              - adds value and returns the previous value.
+ *    Atomic_ExchangeN(address, value)              - stores value and returns the previous value.
+ *    Atomic_CompareExchangeN(address, expected, desired)
+ *                                                  - stores desired if the value equals *expected and returns TRUE,
+ *                                                    otherwise copies the current value to *expected and returns FALSE.
+ *  where N is 8, 16 or 32, and a test-and-set flag:
+ *    Atomic_TestAndSet(flag)                       - sets the flag and returns TRUE if it was already set.
+ *    Atomic_Clear(flag)                            - clears the flag.
+ *  On the Cortex-M4 these retry LDREX/STREX until the store succeeds. The exclusive monitor is cleared on
+ *  exception entry and return, so an interrupt that writes the value between the load and the store makes the
+ *  store fail rather than lose the update. Interrupts are never masked.
+ *  On the host they use the compiler's C11/C++11 memory model builtins, which act on plain (non-_Atomic) objects.
+ *  All operations are sequentially consistent with respect to the compiler.
+ *  The target is single-core, so no DMB is needed between an interrupt and the main loop.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+// new types
+#include "Types\types.h"
+
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+
+#include "cmsis_compiler.h"
+
+// Stops the compiler moving memory accesses across an atomic operation
+#define ATOMIC_BARRIER() __ASM volatile ("" ::: "memory")
+
+#define ATOMIC_DEFINE(bits, suffix) \
+static inline uint##bits##_t Atomic_FetchAdd##bits(volatile uint##bits##_t* const address, const uint##bits##_t value) \
+{ \
+  uint##bits##_t old; \
+  ATOMIC_BARRIER(); \
+  do { \
+    old = __LDREX##suffix(address); \
+  } while (__STREX##suffix((uint##bits##_t)(old + value), address)); \
+  ATOMIC_BARRIER(); \
+  return old; \
+} \
+\
+static inline uint##bits##_t Atomic_Exchange##bits(volatile uint##bits##_t* const address, const uint##bits##_t value) \
+{ \
+  uint##bits##_t old; \
+  ATOMIC_BARRIER(); \
+  do { \
+    old = __LDREX##suffix(address); \
+  } while (__STREX##suffix(value, address)); \
+  ATOMIC_BARRIER(); \
+  return old; \
+} \
+\
+static inline bool Atomic_CompareExchange##bits(volatile uint##bits##_t* const address, uint##bits##_t* const expected, const uint##bits##_t desired) \
+{ \
+  uint##bits##_t old; \
+  ATOMIC_BARRIER(); \
+  do { \
+    old = __LDREX##suffix(address); \
+    if (old != *expected) \
+    { \
+      __CLREX(); \
+      *expected = old; \
+      return false; \
+    } \
+  } while (__STREX##suffix(desired, address)); \
+  ATOMIC_BARRIER(); \
+  return true; \
+}
+
+ATOMIC_DEFINE(8, B)
+ATOMIC_DEFINE(16, H)
+ATOMIC_DEFINE(32, W)
+
+#undef ATOMIC_DEFINE
+
+#elif defined(__GNUC__)
+
+#define ATOMIC_DEFINE(bits) \
+static inline uint##bits##_t Atomic_FetchAdd##bits(volatile uint##bits##_t* const address, const uint##bits##_t value) \
+{ \
+  return __atomic_fetch_add(address, value, __ATOMIC_SEQ_CST); \
+} \
+\
+static inline uint##bits##_t Atomic_Exchange##bits(volatile uint##bits##_t* const address, const uint##bits##_t value) \
+{ \
+  return __atomic_exchange_n(address, value, __ATOMIC_SEQ_CST); \
+} \
+\
+static inline bool Atomic_CompareExchange##bits(volatile uint##bits##_t* const address, uint##bits##_t* const expected, const uint##bits##_t desired) \
+{ \
+  return __atomic_compare_exchange_n(address, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+}
+
+ATOMIC_DEFINE(8)
+ATOMIC_DEFINE(16)
+ATOMIC_DEFINE(32)
+
+#undef ATOMIC_DEFINE
+
+#else
+#error "No atomic operations for this compiler"
+#endif
+
+/*! @brief Sets a flag.
+ *
+ *  @param flag The address of the flag.
+ *  @return bool - TRUE if the flag was already set.
+ */
+static inline bool Atomic_TestAndSet(volatile uint8_t* const flag)
+{
+  return Atomic_Exchange8(flag, 1u) != 0u;
+}
+
+/*! @brief Clears a flag.
+ *
+ *  @param flag The address of the flag.
+ */
+static inline void Atomic_Clear(volatile uint8_t* const flag)
+{
+  (void)Atomic_Exchange8(flag, 0u);
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*! @file
+ *
+ *  @brief Routines for measuring the frequency, period and duty cycle of a signal.
+ *
+ *  The pair runs in continuous dual-edge capture mode: channel n captures rising edges and channel n+1 the falling edge after each.
+ *  A measurement spans from the last rising edge of one block of periods to the last rising edge of the next,
+ *  so only one capture per block has to be extended to 32 bits. It is extended against the counter when the block is processed,
+ *  which the overflow callback keeps valid. FTM3 is set up and its interrupt handled by the FTM module.
+ *  Each period is paired with the high time after its rising edge, so the high time after the last rising edge of a block
+ *  belongs to the next measurement.
+ *  The eDMA fills a buffer of two blocks, and interrupts when each half is full, so one half can be read while the other is written.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "Capture\Capture.h"
+#include "Critical\critical.h"
+#include "FTM\FTM.h"
+#include "MK64F12.h"
+
+// FTM3 channel n requests eDMA source 32 + n
+#define CAPTURE_DMA_SOURCE_FTM3 32
+
+// Distance between the CnV registers of a pair
+#define CAPTURE_CNV_STRIDE 8
+
+// FTM3 is instance 3
+#define CAPTURE_FTM_INSTANCE 3
+
+static uint8_t Channel;
+static uint8_t NbPeriods;
+static uint32_t ModuleClk;
+
+// The counter extended to 32 bits
+static uint32_t LastTime;
+
+// The extended time of the last rising edge of the previous block
+static uint32_t Reference;
+static uint16_t ReferenceHigh;  // The high time after it
+static bool HaveReference;
+
+// Captures read so far in the current block without DMA, and the high times of all but the last
+static uint8_t NbCaptured;
+static uint32_t HighSum;
+
+// Rising and falling edge captures, written by the eDMA
+static volatile uint16_t Buffer[2 * CAPTURE_MAX_PERIODS][2];
+
+static TCaptureMeasurement Measurement;
+
+/*! @brief Gets the extended counter value.
+ *
+ *  @note Must be called at least once per counter overflow.
+ */
+static uint32_t Time(void)
+{
+  uint16_t count = (uint16_t)FTM3->CNT;
+
+  LastTime += (uint16_t)(count - (uint16_t)LastTime);
+  return LastTime;
+}
+
+/*! @brief Extends a capture made within the last counter period to 32 bits.
+ */
+static uint32_t Extend(const uint16_t capture)
+{
+  uint32_t now = Time();
+
+  return now - (uint16_t)((uint16_t)now - capture);
+}
+
+/*! @brief Completes a block of periods.
+ *
+ *  @param rising The extended time of the last rising edge in the block.
+ *  @param highSum The total high time after every rising edge in the block except the last.
+ *  @param high The high time after the last rising edge in the block.
+ */
+static void Complete(const uint32_t rising, const uint32_t highSum, const uint16_t high)
+{
+  uint32_t periodSum = rising - Reference;
+
+  // The first block only marks where the first measurement starts
+  if (HaveReference && periodSum)
+  {
+    Measurement.period = (uint32_t)(((uint64_t)periodSum * 1000000000u) / ModuleClk / NbPeriods);
+    Measurement.frequency = (uint32_t)(((uint64_t)ModuleClk * NbPeriods * 1000u) / periodSum);
+    Measurement.dutyCycle = (uint16_t)(((uint64_t)(ReferenceHigh + highSum) * 10000u) / periodSum);
+    Measurement.count++;
+  }
+
+  Reference = rising;
+  ReferenceHigh = high;
+  HaveReference = true;
+}
+
+/*! @brief Processes one half of the eDMA buffer.
+ */
+static void ProcessBlock(const uint8_t first)
+{
+  uint32_t highSum = 0;
+  uint8_t last = first + NbPeriods - 1;
+
+  // The other half is being written while this one is read
+  for (uint8_t i = first; i < last; i++)
+    highSum += (uint16_t)(Buffer[i][1] - Buffer[i][0]);
+
+  Complete(Extend(Buffer[last][0]), highSum, (uint16_t)(Buffer[last][1] - Buffer[last][0]));
+}
+
+/*! @brief Keeps the extended counter valid when the counter overflows.
+ *
+ *  @param arguments Not used.
+ */
+static void Overflow(void* arguments)
+{
+  (void)Time();
+}
+
+/*! @brief Reads a pair of captures without DMA.
+ *
+ *  @param arguments Not used.
+ */
+static void Captured(void* arguments)
+{
+  uint32_t rising = Extend((uint16_t)FTM3->CONTROLS[Channel].CnV);
+  uint16_t high = (uint16_t)(FTM3->CONTROLS[Channel + 1].CnV - (uint16_t)rising);
+
+  // The first pair only marks where the first measurement starts
+  if (HaveReference && (++NbCaptured < NbPeriods))
+    HighSum += high;
+  else
+  {
+    Complete(rising, HighSum, high);
+    NbCaptured = 0;
+    HighSum = 0;
+  }
+}
+
+bool Capture_Init(const uint8_t channelNb, const uint8_t nbPeriods, const bool useDMA)
+{
+  uint8_t pairShift = (channelNb / 2) * 8;
+  TFTMHandle ftm;
+
+  if ((channelNb & 1) || (channelNb >= 8) || (nbPeriods == 0) || (nbPeriods > CAPTURE_MAX_PERIODS))
+    return false;
+
+  ftm = FTM_Init(CAPTURE_FTM_INSTANCE, 0, CAPTURE_RANGE);
+  if (!ftm)
+    return false;
+  ModuleClk = FTM_Clock(ftm);
+
+  // Captures are timed against the free-running counter, so they preempt FIFO critical sections
+  NVIC_SetPriority(FTM3_IRQn, CRITICAL_PRIORITY_FAST);
+
+  Channel = channelNb;
+  NbPeriods = nbPeriods;
+  HaveReference = false;
+  NbCaptured = 0;
+  HighSum = 0;
+  Measurement.count = 0;
+
+  // Dual-edge capture needs the FTM features enabled
+  FTM3->MODE = FTM_MODE_WPDIS_MASK | FTM_MODE_FTMEN_MASK;
+  LastTime = (uint16_t)FTM3->CNT;
+
+  if (!FTM_SetOverflowCallback(ftm, Overflow, NULL) || !FTM_SetCallback(ftm, channelNb + 1, useDMA ? NULL : Captured, NULL))
+    return false;
+
+  FTM3->COMBINE = FTM_COMBINE_DECAPEN0_MASK << pairShift;
+  FTM3->CONTROLS[channelNb].CnSC = FTM_CnSC_MSA_MASK | FTM_CnSC_ELSA_MASK;
+  FTM3->CONTROLS[channelNb + 1].CnSC = FTM_CnSC_ELSB_MASK | FTM_CnSC_CHIE_MASK | (useDMA ? FTM_CnSC_DMA_MASK : 0);
+
+  if (useDMA)
+  {
+    SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    DMA0->CERQ = DMA_CERQ_CERQ(CAPTURE_DMA_CHANNEL);
+    DMAMUX->CHCFG[CAPTURE_DMA_CHANNEL] = 0;
+
+    // The minor loop offset steps the source back from C(n+1)V to CnV after each pair
+    DMA0->CR |= DMA_CR_EMLM_MASK;
+
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].SADDR = (uint32_t)&FTM3->CONTROLS[channelNb].CnV;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].SOFF = CAPTURE_CNV_STRIDE;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].ATTR = DMA_ATTR_SSIZE(1) | DMA_ATTR_DSIZE(1);
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].NBYTES_MLOFFYES = DMA_NBYTES_MLOFFYES_SMLOE_MASK
+                                                     | DMA_NBYTES_MLOFFYES_MLOFF(-2 * CAPTURE_CNV_STRIDE)
+                                                     | DMA_NBYTES_MLOFFYES_NBYTES(2 * sizeof(uint16_t));
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].SLAST = 0;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].DADDR = (uint32_t)Buffer;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].DOFF = sizeof(uint16_t);
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].CITER_ELINKNO = 2 * nbPeriods;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].BITER_ELINKNO = 2 * nbPeriods;
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].DLAST_SGA = (uint32_t)(-(int32_t)(2 * nbPeriods * sizeof(Buffer[0])));
+    DMA0->TCD[CAPTURE_DMA_CHANNEL].CSR = DMA_CSR_INTHALF_MASK | DMA_CSR_INTMAJOR_MASK;
+
+    DMAMUX->CHCFG[CAPTURE_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(CAPTURE_DMA_SOURCE_FTM3 + channelNb + 1);
+    DMA0->SERQ = DMA_SERQ_SERQ(CAPTURE_DMA_CHANNEL);
+
+    NVIC_SetPriority(DMA0_IRQn, CRITICAL_PRIORITY_FAST);
+    NVIC_ClearPendingIRQ(DMA0_IRQn);
+    NVIC_EnableIRQ(DMA0_IRQn);
+  }
+
+  // Start capturing - in continuous mode DECAP stays set
+  FTM3->COMBINE |= FTM_COMBINE_DECAP0_MASK << pairShift;
+
+  return true;
+}
+
+bool Capture_Get(TCaptureMeasurement* const measurement)
+{
+  EnterCritical();
+  *measurement = Measurement;
+  ExitCritical();
+
+  return (measurement->count > 0);
+}
+
+void __attribute__ ((interrupt)) DMA0_IRQHandler(void)
+{
+  DMA0->CINT = DMA_CINT_CINT(CAPTURE_DMA_CHANNEL);
+
+  // The major loop count is back above half once the second block is complete
+  ProcessBlock((DMA0->TCD[CAPTURE_DMA_CHANNEL].CITER_ELINKNO > NbPeriods) ? NbPeriods : 0);
+}
@@ -0,0 +1,71 @@
+/*! @file
+ *
+ *  @brief Routines for measuring the frequency, period and duty cycle of a signal.
+ *
+ *  This contains the functions for a measurement engine on FTM3 using dual-edge capture.
+ *  A channel pair captures each rising edge and the following falling edge in hardware, so only results are handled in software.
+ *  With DMA, the eDMA copies each pair of captures into a buffer, and the CPU only runs once every nbPeriods periods (see Capture_Init),
+ *  so the interrupt load does not rise with the signal frequency.
+ *  Without DMA, the channel interrupts once per period.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+// new types
+#include "Types\types.h"
+
+// Most periods that can be averaged
+#ifndef CAPTURE_MAX_PERIODS
+#define CAPTURE_MAX_PERIODS 64
+#endif
+
+// Longest high time in nanoseconds - FTM3 gets the finest resolution whose counter spans it
+#ifndef CAPTURE_RANGE
+#define CAPTURE_RANGE 1000000
+#endif
+
+// eDMA channel used to copy the captures - its interrupt is handled by DMA0_IRQHandler
+#define CAPTURE_DMA_CHANNEL 0
+
+/*!
+ * @struct TCaptureMeasurement
+ */
+typedef struct
+{
+  uint32_t period;       /*!< Average period in nanoseconds */
+  uint32_t frequency;    /*!< Average frequency in millihertz */
+  uint16_t dutyCycle;    /*!< Average high time in hundredths of a percent (0-10000) */
+  uint32_t count;        /*!< Number of measurements made since Capture_Init */
+} TCaptureMeasurement;
+
+/*! @brief Sets up FTM3 and starts measuring.
+ *
+ *  The signal goes to the first channel of the pair. The second channel's pin is not used.
+ *  @param channelNb The first channel of the pair (0, 2, 4 or 6).
+ *  @param nbPeriods The number of periods averaged in each measurement (1 to CAPTURE_MAX_PERIODS).
+ *  @param useDMA TRUE to copy the captures with the eDMA, FALSE to read them in the FTM3 interrupt.
+ *  @return bool - TRUE if measuring was started.
+ *  @note Assumes that the pin has been routed to FTM3 in the pin mux. FTM3 cannot be used for anything else.
+ */
+bool Capture_Init(const uint8_t channelNb, const uint8_t nbPeriods, const bool useDMA);
+
+/*! @brief Gets the latest measurement.
+ *
+ *  Each measurement covers nbPeriods consecutive periods.
+ *  The period must be under 2^32 counter ticks, and the high time under CAPTURE_RANGE.
+ *  @param measurement The address to store the measurement.
+ *  @return bool - TRUE if a measurement has been made.
+ */
+bool Capture_Get(TCaptureMeasurement* const measurement);
+
+/*! @brief Interrupt service routine for the capture eDMA channel.
+ *
+ *  Processes the half of the buffer that the eDMA has just filled.
+ */
+void __attribute__ ((interrupt)) DMA0_IRQHandler(void);
+
+#endif
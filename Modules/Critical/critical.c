@@ -0,0 +1,194 @@
+/*! @file
+ *
+ *  @brief Routines to implement protection of critical sections.
+ *
+ *  This contains the storage used by the critical section macros.
+ *
+ *  @author PMcL
+ *  @date 2020-03-03
+ */
+
+#include "Critical\critical.h"
+
+volatile uint8_t SR_reg;       // Current value of the FAULTMASK register
+volatile uint8_t SR_lock = 0u; // Lock
+
+volatile uint8_t SR_basepri;         // Value of the BASEPRI register before the outermost EnterCriticalCeiling
+volatile uint8_t SR_basepriLock = 0u; // Lock
+
+#ifdef CRITICAL_PROFILE
+
+#include "SWO\SWO.h"
+#include "MK64F12.h"
+
+/*!
+ * @struct TCriticalProfileEntry
+ */
+typedef struct
+{
+  uint32_t startCycles;  /*!< Cycle count when the section was entered */
+  const char* file;      /*!< Source file of the Enter call */
+  uint16_t line;         /*!< Source line of the Enter call */
+} TCriticalProfileEntry;
+
+// One table per section type, each updated only under its own mask - interrupts above the ceiling
+// only use EnterCritical, so they never touch the BASEPRI table
+static TCriticalProfileSite Sites[CRITICAL_SECTION_NB][CRITICAL_PROFILE_NB_SITES];
+static uint8_t NbSites[CRITICAL_SECTION_NB];
+static uint32_t NbDropped[CRITICAL_SECTION_NB];  // Holds from call sites that did not fit in the table
+static TCriticalProfileEntry Entries[CRITICAL_SECTION_NB];
+
+/*! @brief Masks all interrupts without profiling the section.
+ *
+ *  @return uint32_t - the previous value of FAULTMASK.
+ */
+static inline uint32_t MaskAll(void)
+{
+  uint32_t faultMask = __get_FAULTMASK();
+
+  __disable_fault_irq();
+  return faultMask;
+}
+
+/*! @brief Restores FAULTMASK saved by MaskAll.
+ */
+static inline void Unmask(const uint32_t faultMask)
+{
+  __set_FAULTMASK(faultMask);
+}
+
+/*! @brief Finds the table entry for a call site, allocating one if needed.
+ *
+ *  @note Must be called with the section's own mask held.
+ *  @return TCriticalProfileSite* - the entry, or NULL if the table is full.
+ */
+static TCriticalProfileSite* FindSite(const TCriticalSection section, const char* const file, const uint16_t line)
+{
+  TCriticalProfileSite* const sites = Sites[section];
+
+  for (uint8_t i = 0; i < NbSites[section]; i++)
+  {
+    if ((sites[i].line == line) && (sites[i].file == file))
+      return &sites[i];
+  }
+
+  if (NbSites[section] >= CRITICAL_PROFILE_NB_SITES)
+    return (TCriticalProfileSite*)0;
+
+  sites[NbSites[section]].file = file;
+  sites[NbSites[section]].line = line;
+  sites[NbSites[section]].section = (uint8_t)section;
+  return &sites[NbSites[section]++];
+}
+
+void Critical_ProfileInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  Critical_ProfileReset();
+}
+
+void Critical_ProfileReset(void)
+{
+  // Not profiled, so that the reset does not add its own call site
+  uint32_t faultMask = MaskAll();
+
+  for (uint8_t section = 0; section < CRITICAL_SECTION_NB; section++)
+  {
+    for (uint8_t i = 0; i < CRITICAL_PROFILE_NB_SITES; i++)
+    {
+      Sites[section][i].count = 0;
+      Sites[section][i].maxCycles = 0;
+      for (uint8_t bucket = 0; bucket < CRITICAL_PROFILE_NB_BUCKETS; bucket++)
+        Sites[section][i].histogram[bucket] = 0;
+    }
+    NbSites[section] = 0;
+    NbDropped[section] = 0;
+  }
+
+  Unmask(faultMask);
+}
+
+void Critical_ProfileEnter(const TCriticalSection section, const char* const file, const uint16_t line)
+{
+  // Only the timestamp is taken here, so the search cost is not charged to the section
+  Entries[section].startCycles = DWT->CYCCNT;
+  Entries[section].file = file;
+  Entries[section].line = line;
+}
+
+void Critical_ProfileExit(const TCriticalSection section)
+{
+  uint32_t cycles, log2Cycles, bucket;
+  TCriticalProfileSite* site;
+
+  cycles = DWT->CYCCNT - Entries[section].startCycles;
+
+  log2Cycles = 31u - __CLZ(cycles | 1u);
+  bucket = (log2Cycles < 5u) ? 0u : log2Cycles - 4u;
+  if (bucket >= CRITICAL_PROFILE_NB_BUCKETS)
+    bucket = CRITICAL_PROFILE_NB_BUCKETS - 1u;
+
+  // Still inside the section, so nothing else can update this section's table
+  site = FindSite(section, Entries[section].file, Entries[section].line);
+  if (!site)
+    NbDropped[section]++;
+  else
+  {
+    site->count++;
+    site->histogram[bucket]++;
+    if (cycles > site->maxCycles)
+      site->maxCycles = cycles;
+  }
+}
+
+void Critical_ProfileDump(void)
+{
+  TCriticalProfileSite site;
+  uint32_t faultMask, nbDropped;
+  uint8_t nbSites;
+
+  for (uint8_t section = 0; section < CRITICAL_SECTION_NB; section++)
+  {
+    // Not profiled, so that the dump does not add call sites to the table it is reading
+    faultMask = MaskAll();
+    nbSites = NbSites[section];
+    Unmask(faultMask);
+
+    for (uint8_t i = 0; i < nbSites; i++)
+    {
+      // Take a consistent copy so that the slow output does not extend the masked time
+      faultMask = MaskAll();
+      site = Sites[section][i];
+      Unmask(faultMask);
+
+      SWO_PutString(site.file);
+      SWO_PutString(":");
+      SWO_PutNumber(site.line);
+      SWO_PutString(site.section == CRITICAL_SECTION_FAULTMASK ? " FAULTMASK" : " BASEPRI");
+      SWO_PutString(" count=");
+      SWO_PutNumber(site.count);
+      SWO_PutString(" max=");
+      SWO_PutNumber(site.maxCycles);
+      SWO_PutString(" hist=");
+      for (uint8_t bucket = 0; bucket < CRITICAL_PROFILE_NB_BUCKETS; bucket++)
+      {
+        if (bucket)
+          SWO_PutString(",");
+        SWO_PutNumber(site.histogram[bucket]);
+      }
+      SWO_PutString("\n");
+    }
+  }
+
+  faultMask = MaskAll();
+  nbDropped = NbDropped[CRITICAL_SECTION_FAULTMASK] + NbDropped[CRITICAL_SECTION_BASEPRI];
+  Unmask(faultMask);
+
+  SWO_PutString("dropped=");
+  SWO_PutNumber(nbDropped);
+  SWO_PutString("\n");
+}
+
+#endif
@@ -3,6 +3,10 @@
  *  @brief Routines to implement protection of critical sections.
  *
  *  This contains the functions for entering and exiting critical sections.
+ *  EnterCritical masks all interrupts using FAULTMASK.
+ *  EnterCriticalCeiling only masks interrupts at or below a priority ceiling using BASEPRI,
+ *  so more urgent interrupts keep running, provided they never touch the protected data.
+ *  Defining CRITICAL_PROFILE instruments both with a hold-time profiler based on the DWT cycle counter.
  *
  *  @author PMcL
  *  @date 2020-03-03
@@ -16,6 +20,78 @@
 extern volatile uint8_t SR_reg;  // Current value of the FAULTMASK register
 extern volatile uint8_t SR_lock; // Lock
 
+/*!
+ * @enum TCriticalSection
+ */
+typedef enum
+{
+  CRITICAL_SECTION_FAULTMASK, /*!< EnterCritical/ExitCritical */
+  CRITICAL_SECTION_BASEPRI,   /*!< EnterCriticalCeiling/ExitCriticalCeiling */
+  CRITICAL_SECTION_NB
+} TCriticalSection;
+
+#ifdef CRITICAL_PROFILE
+
+// Dumps the critical section profile over SWO - a non-zero parameter 1 also clears it
+#define CRITICAL_CMD_PROFILE 0x0F
+
+// Number of distinct call sites of each section type that can be profiled
+#define CRITICAL_PROFILE_NB_SITES 32
+
+// Number of histogram buckets - bucket 0 counts holds under 32 cycles,
+// bucket n counts holds of 2^(n+4) to 2^(n+5)-1 cycles and the last bucket counts everything longer
+#define CRITICAL_PROFILE_NB_BUCKETS 16
+
+/*!
+ * @struct TCriticalProfileSite
+ */
+typedef struct
+{
+  const char* file;                                 /*!< Source file of the outermost Enter call */
+  uint16_t line;                                    /*!< Source line of the outermost Enter call */
+  uint8_t section;                                  /*!< The TCriticalSection type */
+  uint32_t count;                                   /*!< Number of times the section has been held */
+  uint32_t maxCycles;                               /*!< Longest hold time in core clock cycles */
+  uint32_t histogram[CRITICAL_PROFILE_NB_BUCKETS];  /*!< Hold time distribution */
+} TCriticalProfileSite;
+
+/*! @brief Enables the DWT cycle counter and clears the profile.
+ */
+void Critical_ProfileInit(void);
+
+/*! @brief Clears the profile.
+ */
+void Critical_ProfileReset(void);
+
+/*! @brief Writes the profile table to ITM stimulus port 0 (SWO), one line per call site.
+ *
+ *  @note Output is silently discarded if the debugger has not enabled the ITM.
+ */
+void Critical_ProfileDump(void);
+
+/*! @brief Records the start of the outermost critical section.
+ *
+ *  @note Called from the Enter macros once interrupts are masked - not for direct use.
+ */
+void Critical_ProfileEnter(const TCriticalSection section, const char* const file, const uint16_t line);
+
+/*! @brief Records the end of the outermost critical section.
+ *
+ *  Each section type has its own table, so the section's own mask is enough to protect the update.
+ *  @note Called from the Exit macros before interrupts are unmasked - not for direct use.
+ */
+void Critical_ProfileExit(const TCriticalSection section);
+
+#define CRITICAL_PROFILE_ENTER(section) Critical_ProfileEnter((section), __FILE__, __LINE__)
+#define CRITICAL_PROFILE_EXIT(section)  Critical_ProfileExit(section)
+
+#else
+
+#define CRITICAL_PROFILE_ENTER(section)
+#define CRITICAL_PROFILE_EXIT(section)
+
+#endif
+
 // Save status register and disable interrupts
 #define EnterCritical() \
  do {\
@@ -28,6 +104,7 @@ extern volatile uint8_t SR_lock; // Lock
      :: "r0");\
    if (++SR_lock == 1u) {\
      SR_reg = SR_reg_local;\
+     CRITICAL_PROFILE_ENTER(CRITICAL_SECTION_FAULTMASK);\
    }\
  } while(0)
 
@@ -36,6 +113,7 @@ extern volatile uint8_t SR_lock; // Lock
 #define ExitCritical() \
  do {\
    if (--SR_lock == 0u) { \
+     CRITICAL_PROFILE_EXIT(CRITICAL_SECTION_FAULTMASK);\
      __asm (                 \
        "LDRB R0, %[input]\n\t"\
        "MSR FAULTMASK, R0;\n\t" \
@@ -44,4 +122,55 @@ extern volatile uint8_t SR_lock; // Lock
    }\
  } while(0)
 
+// NVIC priority (0-15) of the most urgent interrupt masked by EnterCriticalCeiling.
+// Interrupts with a numerically lower priority are never masked.
+#ifndef CRITICAL_PRIORITY_CEILING
+#define CRITICAL_PRIORITY_CEILING 2
+#endif
+
+#if (CRITICAL_PRIORITY_CEILING < 1) || (CRITICAL_PRIORITY_CEILING > 15)
+#error "CRITICAL_PRIORITY_CEILING must be 1-15 - a BASEPRI of 0 masks nothing"
+#endif
+
+// The K64 NVIC implements the upper 4 bits of each 8-bit priority
+#define CRITICAL_BASEPRI ((CRITICAL_PRIORITY_CEILING) << 4)
+
+// NVIC priorities given by each module's Init - every interrupt resets to priority 0, which the ceiling never masks.
+// Interrupts that touch a FIFO, or call back code that might, run at the default priority and are masked by the ceiling.
+// Capture and encoder sampling preempt EnterCriticalCeiling sections, so they must only use EnterCritical.
+#define CRITICAL_PRIORITY_DEFAULT (CRITICAL_PRIORITY_CEILING)
+#define CRITICAL_PRIORITY_FAST    ((CRITICAL_PRIORITY_CEILING) - 1)
+
+extern volatile uint8_t SR_basepri;     // Value of the BASEPRI register before the outermost EnterCriticalCeiling
+extern volatile uint8_t SR_basepriLock; // Lock
+
+// Save BASEPRI and mask interrupts at or below the priority ceiling
+// BASEPRI_MAX only ever raises the masking level, so a nested call never unmasks anything
+#define EnterCriticalCeiling() \
+ do {\
+  uint8_t SR_basepri_local;\
+   __asm volatile ( \
+     "MRS %[output], BASEPRI\n\t" \
+     "MSR BASEPRI_MAX, %[ceiling]" \
+     : [output] "=&r" (SR_basepri_local)\
+     : [ceiling] "r" (CRITICAL_BASEPRI)\
+     : "memory");\
+   if (++SR_basepriLock == 1u) {\
+     SR_basepri = SR_basepri_local;\
+     CRITICAL_PROFILE_ENTER(CRITICAL_SECTION_BASEPRI);\
+   }\
+ } while(0)
+
+// Restore BASEPRI
+#define ExitCriticalCeiling() \
+ do {\
+   if (--SR_basepriLock == 0u) { \
+     CRITICAL_PROFILE_EXIT(CRITICAL_SECTION_BASEPRI);\
+     __asm volatile (        \
+       "MSR BASEPRI, %[input]" \
+       :: [input] "r" (SR_basepri) \
+       : "memory");           \
+   }\
+ } while(0)
+
 #endif
@@ -0,0 +1,192 @@
+/*! @file
+ *
+ *  @brief Routines for reading rotary encoders with the FTM quadrature decoders.
+ *
+ *  The counter runs from 0 to 0xFFFF and wraps in either direction. Each read extends it to 32 bits by adding the signed 16-bit change
+ *  since the previous read, so the position is right as long as the encoder moves less than half the counter range between reads.
+ *  Stepping on each wrap in the direction given by TOFDIR is not enough: if the encoder crosses the wrap point and back before
+ *  the interrupt runs, TOF only records the last crossing. Since the change is taken from the counter itself,
+ *  any number of crossings between reads is counted correctly.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "Encoder\Encoder.h"
+#include "Critical\critical.h"
+#include "FTM\FTM.h"
+#include "Packet\packet.h"
+#include "PIT\PIT.h"
+#include "MK64F12.h"
+
+// Longest input filter, in units of 4 bus clocks
+#define ENCODER_MAX_FILTER 15
+
+// Encoder n uses FTM instance n + 1
+#define ENCODER_FTM_INSTANCE(encoderNb) ((encoderNb) + 1)
+
+static FTM_Type* const FTMs[ENCODER_NB_ENCODERS] = {FTM1, FTM2};
+static const IRQn_Type IRQs[ENCODER_NB_ENCODERS] = {FTM1_IRQn, FTM2_IRQn};
+
+static uint8_t Running;
+
+// Position of each encoder at the last read - the lower half is the count that was read
+static uint32_t Positions[ENCODER_NB_ENCODERS];
+
+// Positions at the last sample, and the change over the sample before it
+static uint32_t SamplePeriod;
+static int32_t Sampled[ENCODER_NB_ENCODERS];
+static int32_t Delta[ENCODER_NB_ENCODERS];
+
+// Position streaming
+static uint8_t StreamEncoder;
+static uint16_t ReportInterval;
+static uint16_t ReportCount;
+static int32_t ReportPosition;
+static bool ReportDue;
+
+/*! @brief Samples the position of every running encoder.
+ *
+ *  @param arguments Not used.
+ */
+static void Sample(void* arguments)
+{
+  int32_t position;
+
+  for (uint8_t encoderNb = 0; encoderNb < ENCODER_NB_ENCODERS; encoderNb++)
+    if (Running & (1u << encoderNb))
+    {
+      position = Encoder_Position(encoderNb);
+      Delta[encoderNb] = position - Sampled[encoderNb];
+      Sampled[encoderNb] = position;
+    }
+
+  if (ReportInterval && (++ReportCount >= ReportInterval))
+  {
+    ReportCount = 0;
+    ReportPosition = Sampled[StreamEncoder];
+    ReportDue = true;
+  }
+}
+
+bool Encoder_Init(const uint8_t encoderNb, const uint8_t filter)
+{
+  FTM_Type* ftm;
+
+  if ((encoderNb >= ENCODER_NB_ENCODERS) || (filter > ENCODER_MAX_FILTER))
+    return false;
+
+  Running &= ~(1u << encoderNb);
+
+  // Sets up the instance with the bus clock undivided for the filters
+  if (!FTM_Init(ENCODER_FTM_INSTANCE(encoderNb), 0, 0))
+    return false;
+  NVIC_SetPriority(IRQs[encoderNb], CRITICAL_PRIORITY_FAST);
+
+  // The quadrature decoder needs the FTM features enabled
+  ftm = FTMs[encoderNb];
+  ftm->MODE = FTM_MODE_WPDIS_MASK | FTM_MODE_FTMEN_MASK;
+  ftm->SC = 0;
+  ftm->CNT = 0;
+
+  ftm->FILTER = FTM_FILTER_CH0FVAL(filter) | FTM_FILTER_CH1FVAL(filter);
+  ftm->QDCTRL = FTM_QDCTRL_QUADEN_MASK | (filter ? FTM_QDCTRL_PHAFLTREN_MASK | FTM_QDCTRL_PHBFLTREN_MASK : 0);
+
+  Positions[encoderNb] = 0;
+  Sampled[encoderNb] = 0;
+  Delta[encoderNb] = 0;
+
+  // The bus clock drives the filters and synchronisers - the phases drive the counter
+  ftm->SC = FTM_SC_CLKS(1) | FTM_SC_PS(0);
+  Running |= 1u << encoderNb;
+
+  return true;
+}
+
+bool Encoder_SampleInit(const uint8_t channelNb, const uint32_t samplePeriod)
+{
+  if (samplePeriod == 0)
+    return false;
+
+  EnterCritical();
+  SamplePeriod = samplePeriod;
+  for (uint8_t encoderNb = 0; encoderNb < ENCODER_NB_ENCODERS; encoderNb++)
+    if (Running & (1u << encoderNb))
+    {
+      Sampled[encoderNb] = Encoder_Position(encoderNb);
+      Delta[encoderNb] = 0;
+    }
+  ExitCritical();
+
+  // Sample only uses EnterCritical, so it can preempt FIFO critical sections and keep its period steady
+  return PIT_SetCallback(channelNb, Sample, NULL) && PIT_SetPriority(channelNb, CRITICAL_PRIORITY_FAST)
+         && PIT_Set(channelNb, samplePeriod, true);
+}
+
+int32_t Encoder_Position(const uint8_t encoderNb)
+{
+  uint16_t count;
+  uint32_t position;
+
+  EnterCritical();
+  count = (uint16_t)FTMs[encoderNb]->CNT;
+  position = Positions[encoderNb] + (uint32_t)(int16_t)(count - (uint16_t)Positions[encoderNb]);
+  Positions[encoderNb] = position;
+  ExitCritical();
+
+  return (int32_t)position;
+}
+
+int32_t Encoder_Velocity(const uint8_t encoderNb)
+{
+  int32_t delta;
+
+  if ((encoderNb >= ENCODER_NB_ENCODERS) || (SamplePeriod == 0))
+    return 0;
+
+  EnterCritical();
+  delta = Delta[encoderNb];
+  ExitCritical();
+
+  return (int32_t)(((int64_t)delta * 1000000000) / SamplePeriod);
+}
+
+bool Encoder_HandlePacket(void)
+{
+  bool success = false;
+
+  if (((Packet_Command & ~PACKET_ACK_MASK) == ENCODER_CMD_STREAM) && (Packet_Parameter1 < ENCODER_NB_ENCODERS)
+      && (Running & (1u << Packet_Parameter1)) && SamplePeriod)
+  {
+    EnterCritical();
+    StreamEncoder = Packet_Parameter1;
+    ReportInterval = Packet_Parameter23;
+    ReportCount = 0;
+    ReportDue = false;
+    ExitCritical();
+    success = true;
+  }
+
+  if (Packet_Command & PACKET_ACK_MASK)
+    (void)Packet_Put(success ? Packet_Command : (Packet_Command & ~PACKET_ACK_MASK),
+                     Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+
+  return success;
+}
+
+void Encoder_Poll(void)
+{
+  bool due;
+  uint32_t position;
+
+  EnterCritical();
+  due = ReportDue;
+  ReportDue = false;
+  position = (uint32_t)ReportPosition;
+  ExitCritical();
+
+  if (due)
+    (void)Packet_Put(ENCODER_CMD_POSITION, (uint8_t)position, (uint8_t)(position >> 8), (uint8_t)(position >> 16));
+}
@@ -0,0 +1,80 @@
+/*! @file
+ *
+ *  @brief Routines for reading rotary encoders with the FTM quadrature decoders.
+ *
+ *  This contains the functions for tracking encoder position in hardware on FTM1 and FTM2.
+ *  The FTM counts every edge of phases A and B up or down itself, so the CPU does not run for each edge.
+ *  Each read extends the 16-bit counter to a 32-bit position, so the position must be read at least once every 32768 counts.
+ *  The PIT sampling does this if its period is short enough. No counts are lost as long as that holds and the input filter keeps up.
+ *  A PIT channel can sample every encoder at a fixed rate to estimate its velocity, and to stream its position over the serial protocol.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+// new types
+#include "Types\types.h"
+
+// Number of encoders - encoder 0 uses FTM1 and encoder 1 uses FTM2, with phase A on channel 0 and phase B on channel 1
+#define ENCODER_NB_ENCODERS 2
+
+// Encoder commands
+#define ENCODER_CMD_STREAM   0x13  // Parameter 1 - the encoder, parameters 2 and 3 - samples between reports, little-endian, or 0 to stop
+#define ENCODER_CMD_POSITION 0x14  // Sent by the board - parameters 1 to 3 are bits 0 to 23 of the position, little-endian
+
+/*! @brief Sets up an FTM as a quadrature decoder and starts counting from 0.
+ *
+ *  @param encoderNb The encoder (0 to ENCODER_NB_ENCODERS - 1).
+ *  @param filter The input filter length (0 to 15) - an edge is only counted once the phase has been stable for 4 x filter bus clocks.
+ *  @return bool - TRUE if the encoder was started.
+ *  @note Assumes that the phase pins have been routed to the FTM in the pin mux. The FTM cannot be used for anything else.
+ */
+bool Encoder_Init(const uint8_t encoderNb, const uint8_t filter);
+
+/*! @brief Starts sampling the encoders at a fixed rate.
+ *
+ *  Each sample records the position of every encoder that has been started, and the change since the previous sample gives its velocity.
+ *  @param channelNb The PIT channel to use.
+ *  @param samplePeriod The time between samples in nanoseconds, shorter than the time the fastest encoder takes to move 32768 counts.
+ *  @return bool - TRUE if sampling was started.
+ *  @note Assumes that PIT_Init has been called.
+ */
+bool Encoder_SampleInit(const uint8_t channelNb, const uint32_t samplePeriod);
+
+/*! @brief Gets the position of an encoder.
+ *
+ *  @param encoderNb The encoder.
+ *  @return int32_t - the number of counts since Encoder_Init, four per encoder cycle, which wraps.
+ *  @note Assumes that Encoder_Init has been called for the encoder, and that the encoder has moved less than 32768 counts
+ *  since the position was last read, here or by the PIT sampling.
+ */
+int32_t Encoder_Position(const uint8_t encoderNb);
+
+/*! @brief Gets the velocity of an encoder over the last sample period.
+ *
+ *  @param encoderNb The encoder.
+ *  @return int32_t - the velocity in counts per second.
+ *  @note Assumes that Encoder_SampleInit has been called.
+ */
+int32_t Encoder_Velocity(const uint8_t encoderNb);
+
+/*! @brief Handles an encoder packet.
+ *
+ *  The reply has the acknowledgement bit set on success and cleared on failure, and is only sent if an acknowledgement was requested.
+ *  @return bool - TRUE if the packet was an encoder command and succeeded.
+ *  @note Assumes that Packet_Get has returned an ENCODER_CMD_STREAM packet.
+ */
+bool Encoder_HandlePacket(void);
+
+/*! @brief Sends any position report that is due.
+ *
+ *  Reports carry the position sampled by the PIT, so they are evenly spaced however often this is called.
+ *  A report that is not sent before the next one is due is dropped.
+ *  @note Called from the main loop.
+ */
+void Encoder_Poll(void);
+
+#endif
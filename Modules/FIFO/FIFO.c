@@ -0,0 +1,59 @@
+/*! @file
+ *
+ *  @brief Routines to implement a FIFO buffer.
+ *
+ *  This contains the structure and "methods" for accessing a byte-wide FIFO.
+ *
+ *  @author PMcL
+ *  @date 2015-07-23
+ */
+
+#include "FIFO\FIFO.h"
+#include "Critical\critical.h"
+
+bool FIFO_Init(TFIFO* const fifo)
+{
+  fifo->Start   = 0;
+  fifo->End     = 0;
+  fifo->NbBytes = 0;
+
+  return true;
+}
+
+bool FIFO_Put(TFIFO* const fifo, const uint8_t data)
+{
+  EnterCriticalCeiling();
+
+  if (fifo->NbBytes >= FIFO_SIZE)
+  {
+    ExitCriticalCeiling();
+    return false;
+  }
+
+  fifo->Buffer[fifo->End] = data;
+  if (++fifo->End >= FIFO_SIZE)
+    fifo->End = 0;
+  fifo->NbBytes++;
+
+  ExitCriticalCeiling();
+  return true;
+}
+
+bool FIFO_Get(TFIFO* const fifo, uint8_t* const dataPtr)
+{
+  EnterCriticalCeiling();
+
+  if (fifo->NbBytes == 0)
+  {
+    ExitCriticalCeiling();
+    return false;
+  }
+
+  *dataPtr = fifo->Buffer[fifo->Start];
+  if (++fifo->Start >= FIFO_SIZE)
+    fifo->Start = 0;
+  fifo->NbBytes--;
+
+  ExitCriticalCeiling();
+  return true;
+}
@@ -3,6 +3,8 @@
  *  @brief Routines to implement a FIFO buffer.
  *
  *  This contains the structure and "methods" for accessing a byte-wide FIFO.
+ *  Accesses are protected with EnterCriticalCeiling, so a FIFO must only be used by interrupts
+ *  with a priority at or below CRITICAL_PRIORITY_CEILING.
  *
  *  @author PMcL
  *  @date 2015-07-23
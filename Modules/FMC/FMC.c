@@ -0,0 +1,223 @@
+/*! @file
+ *
+ *  @brief Routines for the Flash Memory Controller cache and prefetch buffers.
+ *
+ *  PFB0CR also holds the cache controls shared by both banks, and is changed from the Flash interrupt,
+ *  so every read-modify-write is done in a critical section.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "FMC\FMC.h"
+#include "Critical\critical.h"
+#include "MK64F12.h"
+
+#ifdef FMC_BENCHMARK
+#include "FIFO\FIFO.h"
+#include "SWO\SWO.h"
+#endif
+
+// Bank configuration fields - PFB1CR has the same layout as PFB0CR
+#define FMC_BANK_CONFIG_MASK (FMC_PFB0CR_B0SEBE_MASK | FMC_PFB0CR_B0IPE_MASK | FMC_PFB0CR_B0DPE_MASK \
+                              | FMC_PFB0CR_B0ICE_MASK | FMC_PFB0CR_B0DCE_MASK)
+
+/*! @brief Gets the control register of a bank.
+ */
+static volatile uint32_t* BankRegister(const TFMCBank bank)
+{
+  return (bank == FMC_BANK_0) ? &FMC->PFB0CR : &FMC->PFB1CR;
+}
+
+bool FMC_Configure(const TFMCBank bank, const TFMCBankConfig* const config)
+{
+  volatile uint32_t* bankRegister;
+  uint32_t bits = 0;
+
+  if (bank >= FMC_NB_BANKS)
+    return false;
+
+  bankRegister = BankRegister(bank);
+
+  if (config->singleEntryBuffer)
+    bits |= FMC_PFB0CR_B0SEBE_MASK;
+  if (config->instructionPrefetch)
+    bits |= FMC_PFB0CR_B0IPE_MASK;
+  if (config->dataPrefetch)
+    bits |= FMC_PFB0CR_B0DPE_MASK;
+  if (config->instructionCache)
+    bits |= FMC_PFB0CR_B0ICE_MASK;
+  if (config->dataCache)
+    bits |= FMC_PFB0CR_B0DCE_MASK;
+
+  EnterCritical();
+  *bankRegister = (*bankRegister & ~FMC_BANK_CONFIG_MASK) | bits;
+  ExitCritical();
+
+  FMC_Invalidate();
+  return true;
+}
+
+bool FMC_GetConfig(const TFMCBank bank, TFMCBankConfig* const config)
+{
+  uint32_t bits;
+
+  if (bank >= FMC_NB_BANKS)
+    return false;
+
+  bits = *BankRegister(bank);
+  config->singleEntryBuffer = (bits & FMC_PFB0CR_B0SEBE_MASK) != 0;
+  config->instructionPrefetch = (bits & FMC_PFB0CR_B0IPE_MASK) != 0;
+  config->dataPrefetch = (bits & FMC_PFB0CR_B0DPE_MASK) != 0;
+  config->instructionCache = (bits & FMC_PFB0CR_B0ICE_MASK) != 0;
+  config->dataCache = (bits & FMC_PFB0CR_B0DCE_MASK) != 0;
+
+  return true;
+}
+
+void FMC_SetReplacement(const TFMCReplacement replacement)
+{
+  EnterCritical();
+  FMC->PFB0CR = (FMC->PFB0CR & ~FMC_PFB0CR_CRC_MASK) | FMC_PFB0CR_CRC(replacement);
+  ExitCritical();
+
+  FMC_Invalidate();
+}
+
+void FMC_LockWays(const uint8_t ways)
+{
+  EnterCritical();
+  FMC->PFB0CR = (FMC->PFB0CR & ~FMC_PFB0CR_CLCK_WAY_MASK) | FMC_PFB0CR_CLCK_WAY(ways);
+  ExitCritical();
+}
+
+void FMC_Invalidate(void)
+{
+  // The invalidate bits are self-clearing
+  EnterCritical();
+  FMC->PFB0CR |= FMC_PFB0CR_CINV_WAY(0xF) | FMC_PFB0CR_S_B_INV_MASK;
+  ExitCritical();
+}
+
+#ifdef FMC_BENCHMARK
+
+// Number of runs of each measurement
+#define FMC_BENCHMARK_NB_RUNS 8
+
+/*!
+ * @struct TFMCBenchmarkSetting
+ */
+typedef struct
+{
+  const char* name;       /*!< The setting */
+  TFMCBankConfig config;  /*!< The bank 0 settings */
+} TFMCBenchmarkSetting;
+
+static const TFMCBenchmarkSetting Settings[FMC_BENCHMARK_NB_SETTINGS] =
+{
+  {"off",      {false, false, false, false, false}},
+  {"prefetch", {true,  true,  true,  false, false}},
+  {"cache",    {false, false, false, true,  true}},
+  {"all",      {true,  true,  true,  true,  true}}
+};
+
+// Cycle counts recorded by the software interrupt
+static volatile uint32_t PendCycles;
+static volatile uint32_t EntryCycles;
+static volatile bool Entered;
+
+static TFIFO BenchmarkFIFO;
+
+/*! @brief Measures the cycles from pending the software interrupt to entering its handler.
+ */
+static uint32_t MeasureISREntry(void)
+{
+  Entered = false;
+  PendCycles = DWT->CYCCNT;
+  NVIC_SetPendingIRQ(SWI_IRQn);
+
+  while (!Entered)
+    ;
+
+  return EntryCycles - PendCycles;
+}
+
+/*! @brief Measures the cycles to pass a block of bytes through a FIFO.
+ */
+static uint32_t MeasureFIFOLoop(void)
+{
+  uint32_t start;
+  uint8_t data;
+
+  (void)FIFO_Init(&BenchmarkFIFO);
+
+  start = DWT->CYCCNT;
+  for (uint16_t i = 0; i < FMC_BENCHMARK_FIFO_BYTES; i++)
+  {
+    (void)FIFO_Put(&BenchmarkFIFO, (uint8_t)i);
+    (void)FIFO_Get(&BenchmarkFIFO, &data);
+  }
+
+  return DWT->CYCCNT - start;
+}
+
+void FMC_Benchmark(TFMCBenchmarkResult* const results)
+{
+  TFMCBankConfig saved;
+  TFMCBenchmarkResult result;
+  uint32_t cycles;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  NVIC_SetPriority(SWI_IRQn, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_ClearPendingIRQ(SWI_IRQn);
+  NVIC_EnableIRQ(SWI_IRQn);
+
+  (void)FMC_GetConfig(FMC_BANK_0, &saved);
+
+  for (uint8_t setting = 0; setting < FMC_BENCHMARK_NB_SETTINGS; setting++)
+  {
+    result.name = Settings[setting].name;
+    result.isrEntry = ~0u;
+    result.fifoLoop = ~0u;
+
+    // Configuring also invalidates, so the first run of each setting starts cold
+    (void)FMC_Configure(FMC_BANK_0, &Settings[setting].config);
+
+    for (uint8_t run = 0; run < FMC_BENCHMARK_NB_RUNS; run++)
+    {
+      cycles = MeasureISREntry();
+      if (cycles < result.isrEntry)
+        result.isrEntry = cycles;
+
+      cycles = MeasureFIFOLoop();
+      if (cycles < result.fifoLoop)
+        result.fifoLoop = cycles;
+    }
+
+    SWO_PutString("FMC ");
+    SWO_PutString(result.name);
+    SWO_PutString(": ISR entry ");
+    SWO_PutNumber(result.isrEntry);
+    SWO_PutString(", FIFO loop ");
+    SWO_PutNumber(result.fifoLoop);
+    SWO_PutString(" cycles\n");
+
+    if (results)
+      results[setting] = result;
+  }
+
+  (void)FMC_Configure(FMC_BANK_0, &saved);
+  NVIC_DisableIRQ(SWI_IRQn);
+}
+
+void __attribute__ ((interrupt)) SWI_IRQHandler(void)
+{
+  EntryCycles = DWT->CYCCNT;
+  Entered = true;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*! @file
+ *
+ *  @brief Routines for the Flash Memory Controller cache and prefetch buffers.
+ *
+ *  This contains the functions for configuring the FMC speculation buffers and 4-way cache in front of each
+ *  program flash block (PFB0CR and PFB1CR), and for invalidating them after the Flash contents change.
+ *  Flash has wait states at a 120 MHz core clock, so these settings decide how fast code and constants run from Flash.
+ *  Defining FMC_BENCHMARK adds FMC_Benchmark, which times an ISR entry and a FIFO loop under each setting.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef FMC_H
+#define FMC_H
+
+// new types
+#include "Types\types.h"
+
+/*!
+ * @enum TFMCBank
+ */
+typedef enum
+{
+  FMC_BANK_0,  /*!< Program flash block 0, where code runs from */
+  FMC_BANK_1,  /*!< Program flash block 1 */
+  FMC_NB_BANKS
+} TFMCBank;
+
+/*!
+ * @enum TFMCReplacement
+ *  Cache way allocation, shared by both banks.
+ */
+typedef enum
+{
+  FMC_REPLACEMENT_ALL_WAYS      = 0,  /*!< LRU over all 4 ways for instructions and data */
+  FMC_REPLACEMENT_SPLIT_2_2     = 2,  /*!< Ways 0-1 for instructions, ways 2-3 for data */
+  FMC_REPLACEMENT_SPLIT_3_1     = 3   /*!< Ways 0-2 for instructions, way 3 for data */
+} TFMCReplacement;
+
+/*!
+ * @struct TFMCBankConfig
+ */
+typedef struct
+{
+  bool singleEntryBuffer;    /*!< Single entry buffer */
+  bool instructionPrefetch;  /*!< Prefetch on instruction fetches */
+  bool dataPrefetch;         /*!< Prefetch on data references */
+  bool instructionCache;     /*!< Cache instruction fetches */
+  bool dataCache;            /*!< Cache data references */
+} TFMCBankConfig;
+
+/*! @brief Configures the speculation buffers and cache of a bank.
+ *
+ *  The cache and buffers are invalidated so that no stale entries survive the change.
+ *  @param bank The bank.
+ *  @param config The settings for the bank.
+ *  @return bool - TRUE if the bank was configured successfully.
+ *  @note Must not be called while a Flash command is in progress.
+ */
+bool FMC_Configure(const TFMCBank bank, const TFMCBankConfig* const config);
+
+/*! @brief Reads the current settings of a bank.
+ *
+ *  @param bank The bank.
+ *  @param config The address of a structure to store the settings.
+ *  @return bool - TRUE if the bank is valid.
+ */
+bool FMC_GetConfig(const TFMCBank bank, TFMCBankConfig* const config);
+
+/*! @brief Sets how cache ways are shared between instructions and data.
+ *
+ *  @param replacement The way allocation.
+ */
+void FMC_SetReplacement(const TFMCReplacement replacement);
+
+/*! @brief Locks cache ways so that their contents are kept.
+ *
+ *  @param ways A mask of ways to lock - bit n locks way n.
+ */
+void FMC_LockWays(const uint8_t ways);
+
+/*! @brief Invalidates every cache way and the speculation buffers.
+ *
+ *  Called by the Flash module after each erase or program, since the FMC may still hold the old contents.
+ */
+void FMC_Invalidate(void);
+
+#ifdef FMC_BENCHMARK
+
+// Number of settings measured by FMC_Benchmark
+#define FMC_BENCHMARK_NB_SETTINGS 4
+
+/*!
+ * @struct TFMCBenchmarkResult
+ */
+typedef struct
+{
+  const char* name;      /*!< The setting */
+  uint32_t isrEntry;     /*!< Core clock cycles from pending an interrupt to the first instruction of its handler */
+  uint32_t fifoLoop;     /*!< Core clock cycles to put and get FMC_BENCHMARK_FIFO_BYTES bytes through a FIFO */
+} TFMCBenchmarkResult;
+
+// Number of bytes passed through the FIFO by each FIFO loop
+#define FMC_BENCHMARK_FIFO_BYTES 256
+
+/*! @brief Measures ISR entry and a FIFO loop with the cache and prefetch off, prefetch only, cache only, and both on.
+ *
+ *  Each result is the best of several runs, the first of which starts with the cache invalidated.
+ *  The results are also written to ITM stimulus port 0 (SWO), and the bank 0 settings are restored afterwards.
+ *  @param results An array of FMC_BENCHMARK_NB_SETTINGS results to fill in, or NULL.
+ *  @note Uses the software interrupt (SWI_IRQn), which must not be used for anything else.
+ */
+void FMC_Benchmark(TFMCBenchmarkResult* const results);
+
+/*! @brief Interrupt service routine for the software interrupt used by FMC_Benchmark.
+ */
+void __attribute__ ((interrupt)) SWI_IRQHandler(void);
+
+#endif
+
+#endif
@@ -0,0 +1,730 @@
+/*! @file
+ *
+ *  @brief Routines for setting up the FlexTimer module (FTM).
+ *
+ *  Each instance keeps its own clock rate, callbacks, output compare queue and PWM state, and all four interrupts are handled here,
+ *  so modules that put an instance into a special mode (quadrature decoding, dual-edge capture) attach to it with callbacks.
+ *  The output compare queue keeps its events in a list sorted by deadline, in 32-bit ticks extended from the 16-bit counter.
+ *  The nearest events are loaded into the queue channels. An event more than FTM_QUEUE_HOP ticks away is loaded
+ *  with an intermediate compare instead, so the interrupt runs often enough to extend the counter.
+ *  An event that is pushed out of the nearest by a new one gives up its channel. The events of all instances share one pool.
+ *  PWM runs with the FTM features enabled and enhanced synchronisation: CnV and SWOCTRL writes are buffered
+ *  and a software trigger loads them when the counter reaches MOD. Pairs with SYNCEN clear are not buffered,
+ *  so input captures keep working. Center-aligned PWM uses combine mode with the pulse placed symmetrically about
+ *  the middle of the period, so every channel keeps the same up-counting time base.
+ *
+ *  @author PMcL
+ *  @date 2015-09-04
+ */
+
+#include <stddef.h>
+
+#include "FTM\FTM.h"
+#include "Critical\critical.h"
+#include "Reciprocal\reciprocal.h"
+#include "MK64F12.h"
+#include "fsl_clock.h"
+
+// Marks a queued event that is not loaded into a channel
+#define FTM_NO_CHANNEL 0xFF
+
+// Longest distance to a queue channel's compare - at most half the counter range
+#define FTM_QUEUE_HOP 0x8000u
+
+// A compare this close may be missed, since CnV is only updated on the next counter change
+#define FTM_QUEUE_MIN_LEAD 2
+
+// Full PWM duty cycle in hundredths of a percent
+#define FTM_PWM_FULL_DUTY 10000u
+
+// Longest dead time in bus clocks, with the largest dead time prescaler of 16
+#define FTM_PWM_MAX_DEAD_TIME (63u * 16u)
+
+// Number of counter prescaler settings - the counter runs at the bus clock divided by 2^0 to 2^7
+#define FTM_NB_PRESCALES 8
+
+// Pair control bits in COMBINE - pair m uses the bits shifted left by 8m
+#define FTM_PAIR_SHIFT(channelNb) (((channelNb) / 2) * 8)
+#define FTM_PAIR_MASK (FTM_COMBINE_COMBINE0_MASK | FTM_COMBINE_COMP0_MASK | FTM_COMBINE_DTEN0_MASK | FTM_COMBINE_SYNCEN0_MASK)
+
+/*!
+ * @struct TFTMEvent
+ */
+typedef struct TFTMEvent
+{
+  struct TFTMEvent* next;        /*!< The next event in deadline order, or in the free list */
+  uint32_t deadline;             /*!< The extended counter value at which the event is due */
+  void (*userFunction)(void*);   /*!< The user callback function */
+  void* userArguments;           /*!< The user arguments */
+  uint8_t channelNb;             /*!< The queue channel holding the event, or FTM_NO_CHANNEL */
+  bool hop;                      /*!< TRUE if the channel holds an intermediate compare */
+} TFTMEvent;
+
+/*!
+ * @struct TFTMInstance
+ */
+struct TFTMInstance
+{
+  FTM_Type* const base;                           /*!< The FTM registers */
+  const IRQn_Type irq;                            /*!< The FTM interrupt */
+  volatile uint32_t* const clockGate;             /*!< The SIM clock gate register */
+  const uint32_t clockGateMask;                   /*!< The FTM's bit in the clock gate register */
+  const uint8_t nbChannels;                       /*!< The number of channels */
+
+  uint32_t moduleClk;                             /*!< The counter rate in Hz */
+  uint64_t ticksPerNanosecond;                    /*!< Converts nanoseconds to counter ticks without dividing */
+
+  void (*userFunctions[FTM_NB_CHANNELS])(void*);  /*!< The channel callbacks */
+  void* userArguments[FTM_NB_CHANNELS];
+  uint16_t delayTicks[FTM_NB_CHANNELS];           /*!< The output compare delays */
+  void (*overflowFunction)(void*);                /*!< The counter overflow callback */
+  void* overflowArguments;
+
+  TFTMEvent* head;                                /*!< The queued events in deadline order */
+  TFTMEvent* channelEvents[FTM_NB_CHANNELS];      /*!< The event loaded into each queue channel */
+  uint8_t queueChannels;
+  uint8_t freeChannels;
+  uint8_t nbQueueChannels;
+  uint32_t lastTime;                              /*!< The counter extended to 32 bits - valid while events are queued,
+                                                       since the interrupt then runs every FTM_QUEUE_HOP ticks */
+
+  bool pwmMode;                                   /*!< PWM time base and channels - a combined pair is recorded by its even channel */
+  uint32_t periodTicks;
+  uint8_t pwmChannels;
+  uint8_t combinedChannels;
+  uint8_t centerChannels;
+};
+
+static struct TFTMInstance Instances[FTM_NB_INSTANCES] =
+{
+  {.base = FTM0, .irq = FTM0_IRQn, .clockGate = &SIM->SCGC6, .clockGateMask = SIM_SCGC6_FTM0_MASK, .nbChannels = 8},
+  {.base = FTM1, .irq = FTM1_IRQn, .clockGate = &SIM->SCGC6, .clockGateMask = SIM_SCGC6_FTM1_MASK, .nbChannels = 2},
+  {.base = FTM2, .irq = FTM2_IRQn, .clockGate = &SIM->SCGC6, .clockGateMask = SIM_SCGC6_FTM2_MASK, .nbChannels = 2},
+  {.base = FTM3, .irq = FTM3_IRQn, .clockGate = &SIM->SCGC3, .clockGateMask = SIM_SCGC3_FTM3_MASK, .nbChannels = 8}
+};
+
+static TFTMEvent Events[FTM_QUEUE_NB_EVENTS];
+static TFTMEvent* FreeEvents;
+static bool EventsReady;
+
+/*! @brief Gets the extended counter value.
+ *
+ *  @note Must be called in a critical section.
+ */
+static uint32_t Time(const TFTMHandle ftm)
+{
+  uint16_t count = (uint16_t)ftm->base->CNT;
+
+  ftm->lastTime += (uint16_t)(count - (uint16_t)ftm->lastTime);
+  return ftm->lastTime;
+}
+
+/*! @brief Gives an event's channel back to the free queue channels.
+ */
+static void Release(const TFTMHandle ftm, TFTMEvent* const event)
+{
+  ftm->base->CONTROLS[event->channelNb].CnSC &= ~(FTM_CnSC_CHIE_MASK | FTM_CnSC_CHF_MASK);
+  ftm->channelEvents[event->channelNb] = NULL;
+  ftm->freeChannels |= 1u << event->channelNb;
+  event->channelNb = FTM_NO_CHANNEL;
+}
+
+/*! @brief Loads an event, or an intermediate compare on the way to it, into a queue channel.
+ *
+ *  @note Assumes that the event has a channel or that a queue channel is free.
+ */
+static void Load(const TFTMHandle ftm, TFTMEvent* const event, const uint32_t now)
+{
+  uint32_t remaining = event->deadline - now;
+  uint8_t channelNb = event->channelNb;
+
+  if (channelNb == FTM_NO_CHANNEL)
+  {
+    channelNb = (uint8_t)(31 - __CLZ(ftm->freeChannels));
+    ftm->freeChannels &= ~(1u << channelNb);
+    ftm->channelEvents[channelNb] = event;
+    event->channelNb = channelNb;
+  }
+
+  event->hop = ((int32_t)remaining > (int32_t)FTM_QUEUE_HOP);
+  ftm->base->CONTROLS[channelNb].CnV = event->hop ? (uint16_t)(now + FTM_QUEUE_HOP) : (uint16_t)event->deadline;
+  ftm->base->CONTROLS[channelNb].CnSC = (ftm->base->CONTROLS[channelNb].CnSC & ~FTM_CnSC_CHF_MASK) | FTM_CnSC_CHIE_MASK;
+
+  // Too close to rely on the compare - the interrupt waits out the last ticks instead
+  if (!event->hop && ((int32_t)remaining <= FTM_QUEUE_MIN_LEAD))
+    NVIC_SetPendingIRQ(ftm->irq);
+}
+
+/*! @brief Loads the nearest events into the queue channels.
+ *
+ *  @note Must be called in a critical section after each insertion or removal.
+ */
+static void Refill(const TFTMHandle ftm)
+{
+  TFTMEvent* event = ftm->head;
+  uint32_t now = Time(ftm);
+
+  // One insertion pushes at most one event out of the nearest, which frees its channel for the new one
+  for (uint8_t i = 0; event && (i < ftm->nbQueueChannels); i++)
+    event = event->next;
+  if (event && (event->channelNb != FTM_NO_CHANNEL))
+    Release(ftm, event);
+
+  event = ftm->head;
+  for (uint8_t i = 0; event && (i < ftm->nbQueueChannels); i++)
+  {
+    if ((event->channelNb == FTM_NO_CHANNEL) || event->hop)
+      Load(ftm, event, now);
+    event = event->next;
+  }
+}
+
+/*! @brief Returns an instance's queued events to the pool and frees its queue channels.
+ *
+ *  @note Must be called in a critical section.
+ */
+static void QueueClear(const TFTMHandle ftm)
+{
+  TFTMEvent* event;
+
+  // The pool is filled once, since it is shared by all instances
+  if (!EventsReady)
+  {
+    for (uint8_t i = 0; i < FTM_QUEUE_NB_EVENTS; i++)
+    {
+      Events[i].next = FreeEvents;
+      FreeEvents = &Events[i];
+    }
+    EventsReady = true;
+  }
+
+  while (ftm->head)
+  {
+    event = ftm->head;
+    ftm->head = event->next;
+    event->next = FreeEvents;
+    FreeEvents = event;
+  }
+
+  for (uint8_t channelNb = 0; channelNb < FTM_NB_CHANNELS; channelNb++)
+    ftm->channelEvents[channelNb] = NULL;
+
+  ftm->queueChannels = 0;
+  ftm->freeChannels = 0;
+  ftm->nbQueueChannels = 0;
+}
+
+/*! @brief Writes the compare values of a PWM channel for a duty cycle.
+ *
+ *  @note The values are buffered until the next software synchronisation.
+ */
+static void WriteDuty(const TFTMHandle ftm, const uint8_t channelNb, const uint16_t dutyCycle)
+{
+  // The divisor is a constant, so this compiles to a multiply
+  uint32_t pulse = (ftm->periodTicks * (dutyCycle > FTM_PWM_FULL_DUTY ? FTM_PWM_FULL_DUTY : dutyCycle)) / FTM_PWM_FULL_DUTY;
+  uint32_t start = 0;
+
+  if (!(ftm->combinedChannels & (1u << channelNb)))
+  {
+    // Edge-aligned - high from the start of the period to CnV, and a CnV past MOD gives 100%
+    ftm->base->CONTROLS[channelNb].CnV = pulse;
+    return;
+  }
+
+  if (ftm->centerChannels & (1u << channelNb))
+    start = (ftm->periodTicks - pulse) / 2;
+
+  // Combined - high from CnV to C(n+1)V
+  ftm->base->CONTROLS[channelNb].CnV = start;
+  ftm->base->CONTROLS[channelNb + 1].CnV = start + pulse;
+}
+
+/*! @brief Sets up a channel for PWM.
+ */
+static bool SetPWM(const TFTMHandle ftm, const uint8_t channelNb, const TTimerPWM* const pwm)
+{
+  FTM_Type* base = ftm->base;
+  uint8_t shift = FTM_PAIR_SHIFT(channelNb);
+  uint32_t level = pwm->activeLow ? FTM_CnSC_ELSA_MASK : FTM_CnSC_ELSB_MASK;
+  bool combined = pwm->complementary || (pwm->alignment == TIMER_PWM_CENTER_ALIGNED);
+  uint8_t pair = 3u << (channelNb & ~1u);
+
+  if (!ftm->pwmMode || (combined && (channelNb & 1)))
+    return false;
+
+  // Setting up either channel of a combined pair releases the whole pair
+  if (ftm->combinedChannels & (1u << (channelNb & ~1u)))
+  {
+    ftm->pwmChannels &= ~pair;
+    ftm->combinedChannels &= ~pair;
+    ftm->centerChannels &= ~pair;
+  }
+
+  base->COMBINE &= ~(FTM_PAIR_MASK << shift);
+  base->CONTROLS[channelNb].CnSC = 0;
+
+  if (combined)
+  {
+    base->COMBINE |= (FTM_COMBINE_COMBINE0_MASK | FTM_COMBINE_SYNCEN0_MASK
+                      | (pwm->complementary ? FTM_COMBINE_COMP0_MASK | FTM_COMBINE_DTEN0_MASK : 0)) << shift;
+    base->CONTROLS[channelNb + 1].CnSC = level;
+    base->CONTROLS[channelNb].CnSC = level;
+    ftm->pwmChannels |= pair;
+    ftm->combinedChannels |= 1u << channelNb;
+    if (pwm->alignment == TIMER_PWM_CENTER_ALIGNED)
+      ftm->centerChannels |= 1u << channelNb;
+  }
+  else
+  {
+    base->COMBINE |= FTM_COMBINE_SYNCEN0_MASK << shift;
+    base->CONTROLS[channelNb].CnSC = FTM_CnSC_MSB_MASK | level;
+    ftm->pwmChannels |= 1u << channelNb;
+    ftm->centerChannels &= ~(1u << channelNb);
+  }
+
+  WriteDuty(ftm, channelNb, pwm->dutyCycle);
+  base->SYNC |= FTM_SYNC_SWSYNC_MASK;
+
+  return true;
+}
+
+/*! @brief Runs the queued events that are due and reloads the queue channels.
+ */
+static void QueueService(const TFTMHandle ftm)
+{
+  TFTMEvent* event;
+  void (*userFunction)(void*);
+  void* userArguments;
+
+  EnterCritical();
+  for (;;)
+  {
+    event = ftm->head;
+    if (!event || ((int32_t)(event->deadline - Time(ftm)) > FTM_QUEUE_MIN_LEAD))
+      break;
+
+    while ((int32_t)(event->deadline - Time(ftm)) > 0)
+      ;
+
+    ftm->head = event->next;
+    if (event->channelNb != FTM_NO_CHANNEL)
+      Release(ftm, event);
+    userFunction = event->userFunction;
+    userArguments = event->userArguments;
+    event->next = FreeEvents;
+    FreeEvents = event;
+
+    ExitCritical();
+    userFunction(userArguments);
+    EnterCritical();
+  }
+
+  Refill(ftm);
+  ExitCritical();
+}
+
+/*! @brief Handles an instance's interrupt.
+ */
+static void Service(const TFTMHandle ftm)
+{
+  FTM_Type* base = ftm->base;
+  uint32_t cnsc;
+
+  if ((base->SC & (FTM_SC_TOF_MASK | FTM_SC_TOIE_MASK)) == (FTM_SC_TOF_MASK | FTM_SC_TOIE_MASK))
+  {
+    // Write 0 to clear after reading 1 - together with the callback, so code reading the flag sees both or neither
+    EnterCritical();
+    base->SC &= ~FTM_SC_TOF_MASK;
+    if (ftm->overflowFunction)
+      ftm->overflowFunction(ftm->overflowArguments);
+    ExitCritical();
+  }
+
+  for (uint8_t channelNb = 0; channelNb < ftm->nbChannels; channelNb++)
+  {
+    cnsc = base->CONTROLS[channelNb].CnSC;
+
+    // Channels with DMA have their flags cleared by the eDMA
+    if (!(cnsc & FTM_CnSC_CHF_MASK) || !(cnsc & FTM_CnSC_CHIE_MASK) || (cnsc & FTM_CnSC_DMA_MASK))
+      continue;
+
+    // Write 0 to clear after reading 1
+    base->CONTROLS[channelNb].CnSC = cnsc & ~FTM_CnSC_CHF_MASK;
+
+    // Queue channels are handled together below
+    if (ftm->queueChannels & (1u << channelNb))
+      continue;
+
+    // Output compares are one-shot until started again
+    if (cnsc & FTM_CnSC_MSA_MASK)
+      base->CONTROLS[channelNb].CnSC &= ~FTM_CnSC_CHIE_MASK;
+
+    if (ftm->userFunctions[channelNb])
+      ftm->userFunctions[channelNb](ftm->userArguments[channelNb]);
+  }
+
+  if (ftm->queueChannels)
+    QueueService(ftm);
+}
+
+TFTMHandle FTM_Init(const uint8_t instanceNb, const uint32_t resolution, const uint32_t range)
+{
+  TFTMHandle ftm;
+  FTM_Type* base;
+  uint32_t busClk = CLOCK_GetBusClkFreq();
+  uint64_t reciprocal = 0;
+  uint8_t prescale;
+
+  if ((instanceNb >= FTM_NB_INSTANCES) || (busClk == 0) || (busClk > 1000000000u))
+    return NULL;
+
+  // The finest resolution whose 16-bit counter still spans the range
+  for (prescale = 0; prescale < FTM_NB_PRESCALES; prescale++)
+  {
+    reciprocal = Reciprocal_Init(busClk >> prescale, 1000000000u);
+    if (Reciprocal_Scale(range, reciprocal) <= 0xFFFF)
+      break;
+  }
+
+  // A tick longer than the resolution - the range and the resolution cannot both be met
+  if ((prescale == FTM_NB_PRESCALES) || (resolution && (Reciprocal_Scale(resolution, reciprocal) == 0)))
+    return NULL;
+
+  ftm = &Instances[instanceNb];
+  base = ftm->base;
+  *ftm->clockGate |= ftm->clockGateMask;
+  NVIC_DisableIRQ(ftm->irq);
+
+  // Allow writes to the protected registers, and stop the counter while setting it up
+  base->MODE = FTM_MODE_WPDIS_MASK;
+  base->SC = 0;
+
+  // Undo the PWM, quadrature decoder and dual-edge capture set-ups of an earlier use
+  // SYNCONF is cleared first, so that SWOCTRL and COMBINE take effect without waiting for a synchronization
+  base->SYNCONF = 0;
+  base->SYNC = 0;
+  base->SWOCTRL = 0;
+  base->COMBINE = 0;
+  base->DEADTIME = 0;
+  base->QDCTRL = 0;
+  base->FILTER = 0;
+
+  base->CNTIN = 0;
+  base->MOD = 0xFFFF;
+  base->CNT = 0;
+
+  for (uint8_t channelNb = 0; channelNb < ftm->nbChannels; channelNb++)
+  {
+    base->CONTROLS[channelNb].CnSC = 0;
+    ftm->userFunctions[channelNb] = NULL;
+  }
+  ftm->overflowFunction = NULL;
+
+  EnterCritical();
+  QueueClear(ftm);
+  ExitCritical();
+
+  ftm->pwmMode = false;
+  ftm->pwmChannels = 0;
+  ftm->combinedChannels = 0;
+  ftm->centerChannels = 0;
+
+  ftm->moduleClk = busClk >> prescale;
+  ftm->ticksPerNanosecond = reciprocal;
+
+  base->SC = FTM_SC_CLKS(1) | FTM_SC_PS(prescale);
+
+  NVIC_SetPriority(ftm->irq, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_ClearPendingIRQ(ftm->irq);
+  NVIC_EnableIRQ(ftm->irq);
+
+  return ftm;
+}
+
+uint32_t FTM_Ticks(const TFTMHandle ftm, const uint32_t nanoseconds)
+{
+  return Reciprocal_Scale(nanoseconds, ftm->ticksPerNanosecond);
+}
+
+uint32_t FTM_Clock(const TFTMHandle ftm)
+{
+  return ftm->moduleClk;
+}
+
+bool FTM_SetCallback(const TFTMHandle ftm, const uint8_t channelNb, void (*userFunction)(void*), void* userArguments)
+{
+  if ((channelNb >= ftm->nbChannels) || (ftm->queueChannels & (1u << channelNb)))
+    return false;
+
+  EnterCritical();
+  ftm->userFunctions[channelNb] = userFunction;
+  ftm->userArguments[channelNb] = userArguments;
+  ExitCritical();
+
+  return true;
+}
+
+bool FTM_SetOverflowCallback(const TFTMHandle ftm, void (*userFunction)(void*), void* userArguments)
+{
+  EnterCritical();
+  ftm->overflowFunction = userFunction;
+  ftm->overflowArguments = userArguments;
+
+  // Clear any earlier overflow, so the first callback is for a new one
+  if (userFunction)
+    ftm->base->SC = (ftm->base->SC & ~FTM_SC_TOF_MASK) | FTM_SC_TOIE_MASK;
+  else
+    ftm->base->SC &= ~(FTM_SC_TOF_MASK | FTM_SC_TOIE_MASK);
+  ExitCritical();
+
+  return true;
+}
+
+bool FTM_Set(const TFTMHandle ftm, const TFTMChannel* const aFTMChannel)
+{
+  uint8_t channelNb = aFTMChannel->channelNb;
+  FTM_Type* base = ftm->base;
+  uint32_t cnsc = 0;
+  uint32_t ticks = 0;
+
+  if ((channelNb >= ftm->nbChannels) || (ftm->queueChannels & (1u << channelNb)))
+    return false;
+
+  if (aFTMChannel->timerFunction == TIMER_FUNCTION_PWM)
+    return SetPWM(ftm, channelNb, &aFTMChannel->ioType.pwm);
+
+  // PWM channels stay PWM, and output compares need the free running counter
+  if ((ftm->pwmChannels & (1u << channelNb)) || (ftm->pwmMode && (aFTMChannel->timerFunction == TIMER_FUNCTION_OUTPUT_COMPARE)))
+    return false;
+
+  if (aFTMChannel->timerFunction == TIMER_FUNCTION_OUTPUT_COMPARE)
+  {
+    // Converted once here, so starting the timer does not divide
+    ticks = FTM_Ticks(ftm, aFTMChannel->delayNanoseconds);
+    if ((ticks == 0) || (ticks > 0xFFFF))
+      return false;
+
+    cnsc = FTM_CnSC_MSA_MASK;
+    switch (aFTMChannel->ioType.outputAction)
+    {
+      case TIMER_OUTPUT_TOGGLE:
+        cnsc |= FTM_CnSC_ELSA_MASK;
+        break;
+      case TIMER_OUTPUT_LOW:
+        cnsc |= FTM_CnSC_ELSB_MASK;
+        break;
+      case TIMER_OUTPUT_HIGH:
+        cnsc |= FTM_CnSC_ELSA_MASK | FTM_CnSC_ELSB_MASK;
+        break;
+      default:
+        break;
+    }
+  }
+  else
+  {
+    switch (aFTMChannel->ioType.inputDetection)
+    {
+      case TIMER_INPUT_RISING:
+        cnsc = FTM_CnSC_ELSA_MASK;
+        break;
+      case TIMER_INPUT_FALLING:
+        cnsc = FTM_CnSC_ELSB_MASK;
+        break;
+      case TIMER_INPUT_ANY:
+        cnsc = FTM_CnSC_ELSA_MASK | FTM_CnSC_ELSB_MASK;
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Disable the channel's interrupt so it never sees a half-updated callback
+  base->CONTROLS[channelNb].CnSC = 0;
+  ftm->delayTicks[channelNb] = (uint16_t)ticks;
+  ftm->userFunctions[channelNb] = aFTMChannel->callbackFunction;
+  ftm->userArguments[channelNb] = aFTMChannel->callbackArguments;
+
+  // Input captures interrupt as soon as they are set up, output compares when they are started
+  if ((aFTMChannel->timerFunction == TIMER_FUNCTION_INPUT_CAPTURE) && aFTMChannel->callbackFunction)
+    cnsc |= FTM_CnSC_CHIE_MASK;
+  base->CONTROLS[channelNb].CnSC = cnsc;
+
+  return true;
+}
+
+bool FTM_StartTimer(const TFTMHandle ftm, const TFTMChannel* const aFTMChannel)
+{
+  uint8_t channelNb = aFTMChannel->channelNb;
+  FTM_Type* base = ftm->base;
+
+  if ((channelNb >= ftm->nbChannels) || (ftm->queueChannels & (1u << channelNb)) || ftm->pwmMode
+      || !(base->CONTROLS[channelNb].CnSC & FTM_CnSC_MSA_MASK))
+    return false;
+
+  base->CONTROLS[channelNb].CnV = (uint16_t)(base->CNT + ftm->delayTicks[channelNb]);
+  base->CONTROLS[channelNb].CnSC = (base->CONTROLS[channelNb].CnSC & ~FTM_CnSC_CHF_MASK) | FTM_CnSC_CHIE_MASK;
+
+  return true;
+}
+
+bool FTM_QueueInit(const TFTMHandle ftm, const uint8_t channelMask)
+{
+  if (ftm->pwmMode || (channelMask >> ftm->nbChannels))
+    return false;
+
+  EnterCritical();
+  QueueClear(ftm);
+
+  for (uint8_t channelNb = 0; channelNb < ftm->nbChannels; channelNb++)
+    if (channelMask & (1u << channelNb))
+    {
+      // Software output compare - the pin is not driven
+      ftm->base->CONTROLS[channelNb].CnSC = FTM_CnSC_MSA_MASK;
+      ftm->userFunctions[channelNb] = NULL;
+    }
+
+  ftm->queueChannels = channelMask;
+  ftm->freeChannels = channelMask;
+  ftm->nbQueueChannels = (uint8_t)__builtin_popcount(channelMask);
+
+  ftm->lastTime = (uint16_t)ftm->base->CNT;
+  ExitCritical();
+
+  return (ftm->nbQueueChannels > 0);
+}
+
+bool FTM_QueueAdd(const TFTMHandle ftm, const uint32_t delayTicks, void (*userFunction)(void*), void* userArguments)
+{
+  TFTMEvent* event;
+  TFTMEvent** link;
+
+  if ((delayTicks == 0) || (delayTicks > FTM_QUEUE_MAX_DELAY) || !userFunction || !ftm->queueChannels)
+    return false;
+
+  EnterCritical();
+  event = FreeEvents;
+  if (!event)
+  {
+    ExitCritical();
+    return false;
+  }
+  FreeEvents = event->next;
+
+  event->deadline = Time(ftm) + delayTicks;
+  event->userFunction = userFunction;
+  event->userArguments = userArguments;
+  event->channelNb = FTM_NO_CHANNEL;
+  event->hop = false;
+
+  // After any events with the same deadline, so they run in the order they were added
+  link = &ftm->head;
+  while (*link && ((int32_t)((*link)->deadline - event->deadline) <= 0))
+    link = &(*link)->next;
+  event->next = *link;
+  *link = event;
+
+  Refill(ftm);
+  ExitCritical();
+
+  return true;
+}
+
+bool FTM_PWMInit(const TFTMHandle ftm, const uint32_t period, const uint32_t deadTime)
+{
+  FTM_Type* base = ftm->base;
+  uint32_t busClk = CLOCK_GetBusClkFreq();
+  uint32_t ticks = 0, deadTicks;
+  uint64_t reciprocal = 0;
+  uint8_t prescale;
+
+  if (ftm->queueChannels || (busClk == 0) || (busClk > 1000000000u))
+    return false;
+
+  // The finest resolution that fits the period in the 16-bit counter
+  for (prescale = 0; prescale < FTM_NB_PRESCALES; prescale++)
+  {
+    reciprocal = Reciprocal_Init(busClk >> prescale, 1000000000u);
+    ticks = Reciprocal_Scale(period, reciprocal);
+    if (ticks <= 0x10000)
+      break;
+  }
+  if ((prescale == FTM_NB_PRESCALES) || (ticks < 2))
+    return false;
+
+  // Dead time counts bus clocks, divided by 1, 4 or 16, rounded up so the outputs never overlap
+  deadTicks = Reciprocal_Scale(deadTime, Reciprocal_Init(busClk, 1000000000u));
+  if ((uint64_t)deadTicks * 1000000000u < (uint64_t)deadTime * busClk)
+    deadTicks++;
+  if (deadTicks > FTM_PWM_MAX_DEAD_TIME)
+    return false;
+
+  base->SC = 0;
+  base->MODE = FTM_MODE_WPDIS_MASK | FTM_MODE_FTMEN_MASK;
+  base->CNTIN = 0;
+  base->MOD = ticks - 1;
+  base->CNT = 0;
+
+  if (deadTicks <= 63)
+    base->DEADTIME = FTM_DEADTIME_DTPS(0) | FTM_DEADTIME_DTVAL(deadTicks);
+  else if (deadTicks <= 63 * 4)
+    base->DEADTIME = FTM_DEADTIME_DTPS(2) | FTM_DEADTIME_DTVAL((deadTicks + 3) / 4);
+  else
+    base->DEADTIME = FTM_DEADTIME_DTPS(3) | FTM_DEADTIME_DTVAL((deadTicks + 15) / 16);
+
+  // Enhanced synchronisation - a software trigger loads CnV and SWOCTRL when the counter reaches MOD
+  base->SYNCONF = FTM_SYNCONF_SYNCMODE_MASK | FTM_SYNCONF_SWWRBUF_MASK | FTM_SYNCONF_SWOC_MASK;
+  base->SYNC = FTM_SYNC_CNTMAX_MASK;
+
+  ftm->moduleClk = busClk >> prescale;
+  ftm->ticksPerNanosecond = reciprocal;
+  ftm->periodTicks = ticks;
+  ftm->pwmMode = true;
+
+  // An overflow callback keeps its interrupt
+  base->SC = FTM_SC_CLKS(1) | FTM_SC_PS(prescale) | (ftm->overflowFunction ? FTM_SC_TOIE_MASK : 0);
+
+  return true;
+}
+
+bool FTM_PWMSetDuty(const TFTMHandle ftm, const uint8_t channelNb, const uint16_t dutyCycle)
+{
+  if ((channelNb >= ftm->nbChannels) || !(ftm->pwmChannels & (1u << channelNb)))
+    return false;
+
+  // Combined pairs are controlled through their even channel
+  WriteDuty(ftm, channelNb & ((ftm->combinedChannels & (1u << (channelNb & ~1u))) ? ~1u : ~0u), dutyCycle);
+  ftm->base->SYNC |= FTM_SYNC_SWSYNC_MASK;
+
+  return true;
+}
+
+bool FTM_PWMOutputControl(const TFTMHandle ftm, const uint8_t channelMask, const uint8_t levels)
+{
+  if (!ftm->pwmMode)
+    return false;
+
+  ftm->base->SWOCTRL = channelMask | ((uint32_t)levels << FTM_SWOCTRL_CH0OCV_SHIFT);
+  ftm->base->SYNC |= FTM_SYNC_SWSYNC_MASK;
+
+  return true;
+}
+
+void __attribute__ ((interrupt)) FTM0_IRQHandler(void)
+{
+  Service(&Instances[0]);
+}
+
+void __attribute__ ((interrupt)) FTM1_IRQHandler(void)
+{
+  Service(&Instances[1]);
+}
+
+void __attribute__ ((interrupt)) FTM2_IRQHandler(void)
+{
+  Service(&Instances[2]);
+}
+
+void __attribute__ ((interrupt)) FTM3_IRQHandler(void)
+{
+  Service(&Instances[3]);
+}
@@ -2,7 +2,14 @@
  *
  *  @brief Routines for setting up the FlexTimer module (FTM).
  *
- *  This contains the functions for operating the FlexTimer module (FTM).
+ *  This contains the functions for operating the FlexTimer modules (FTM).
+ *  Each of FTM0 to FTM3 is an instance with its own handle, prescaler and callbacks.
+ *  An instance runs from the bus clock as a free running 16-bit counter, through the prescaler that gives the finest resolution
+ *  for the range it needs, so a fast instance and a long-interval instance can run at the same time.
+ *  Channels can also be given to a queue of output compare events, which keeps the nearest events loaded
+ *  into those channels and refills them from the interrupt, so any number of events can be pending.
+ *  FTM_PWMInit instead turns the counter into a PWM period, after which channels can generate edge or center-aligned PWM,
+ *  including complementary pairs with dead time. Duty cycle changes are loaded at the end of a period, so outputs never glitch.
  *
  *  @author PMcL
  *  @date 2015-09-04
@@ -14,10 +21,28 @@
 // new types
 #include "Types\types.h"
 
+// Number of FTM instances
+#define FTM_NB_INSTANCES 4
+
+// Most channels in an instance - FTM0 and FTM3 have 8, FTM1 and FTM2 have 2
+#define FTM_NB_CHANNELS 8
+
+// Number of events that can be pending in the output compare queue
+#ifndef FTM_QUEUE_NB_EVENTS
+#define FTM_QUEUE_NB_EVENTS 32
+#endif
+
+// Longest delay of a queued event in counter ticks
+#define FTM_QUEUE_MAX_DELAY 0x7FFFFFFFu
+
+/*! An FTM instance, from FTM_Init */
+typedef struct TFTMInstance* TFTMHandle;
+
 typedef enum
 {
   TIMER_FUNCTION_INPUT_CAPTURE,
-  TIMER_FUNCTION_OUTPUT_COMPARE
+  TIMER_FUNCTION_OUTPUT_COMPARE,
+  TIMER_FUNCTION_PWM
 } TTimerFunction;
 
 typedef enum
@@ -36,6 +61,23 @@ typedef enum
   TIMER_INPUT_ANY
 } TTimerInputDetection;
 
+typedef enum
+{
+  TIMER_PWM_EDGE_ALIGNED,
+  TIMER_PWM_CENTER_ALIGNED
+} TTimerPWMAlignment;
+
+/*!
+ * @struct TTimerPWM
+ */
+typedef struct
+{
+  TTimerPWMAlignment alignment;  /*!< Edge-aligned pulses start each period, center-aligned pulses are centered in it */
+  bool complementary;            /*!< TRUE to drive channel n+1 with the inverse of channel n, with dead time at each edge */
+  bool activeLow;                /*!< TRUE if the pulse is low */
+  uint16_t dutyCycle;            /*!< Pulse width in hundredths of a percent of the period (0-10000) */
+} TTimerPWM;
+
 typedef struct
 {
   uint8_t channelNb;
@@ -45,21 +87,71 @@ typedef struct
   {
     TTimerOutputAction outputAction;
     TTimerInputDetection inputDetection;
+    TTimerPWM pwm;
   } ioType;
   void (*callbackFunction)(void*);
   void *callbackArguments;
 } TFTMChannel;
 
 
-/*! @brief Sets up the FTM before first use.
+/*! @brief Sets up an FTM instance before first use.
+ *
+ *  Enables the FTM as a free running 16-bit counter, with the smallest prescaler whose counter spans the range.
+ *  Calling it again resets the instance, including any PWM, quadrature decoder or dual-edge capture set-up,
+ *  and the earlier handle stays valid.
+ *  @param instanceNb The FTM to use (0 to FTM_NB_INSTANCES - 1).
+ *  @param resolution The longest acceptable counter tick in nanoseconds, or 0 for any.
+ *  @param range The longest time the counter must span in nanoseconds, which is the longest output compare delay,
+ *               or 0 for the finest resolution.
+ *  @return TFTMHandle - the instance, or NULL if the instance number is invalid or the resolution and range cannot both be met.
+ */
+TFTMHandle FTM_Init(const uint8_t instanceNb, const uint32_t resolution, const uint32_t range);
+
+/*! @brief Converts a time to counter ticks.
+ *
+ *  The conversion is a multiply and shift by a reciprocal computed in FTM_Init, and is exact.
+ *  @param ftm The instance.
+ *  @param nanoseconds The time in nanoseconds.
+ *  @return uint32_t - the number of counter ticks, rounded down.
+ *  @note Assumes the FTM has been initialized.
+ */
+uint32_t FTM_Ticks(const TFTMHandle ftm, const uint32_t nanoseconds);
+
+/*! @brief Gets the counter rate.
+ *
+ *  @param ftm The instance.
+ *  @return uint32_t - the counter rate in Hz.
+ *  @note Assumes the FTM has been initialized.
+ */
+uint32_t FTM_Clock(const TFTMHandle ftm);
+
+/*! @brief Sets the function called when a channel's flag is set, without changing how the channel is set up.
+ *
+ *  For modules that set up channels themselves, such as dual-edge capture. Channels that request DMA are not called.
+ *  @param ftm The instance.
+ *  @param channelNb The channel number.
+ *  @param userFunction is a pointer to a user callback function, or NULL.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the channel number is valid.
+ *  @note Assumes the FTM has been initialized.
+ */
+bool FTM_SetCallback(const TFTMHandle ftm, const uint8_t channelNb, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Sets the function called when the counter overflows, and enables the overflow interrupt.
  *
- *  Enables the FTM as a free running 16-bit counter.
- *  @return bool - TRUE if the FTM was successfully initialized.
+ *  The callback runs in a critical section together with clearing the overflow flag, so code that reads the counter
+ *  and the flag in a critical section always sees a consistent count. It should only do a little work, such as extending a count.
+ *  @param ftm The instance.
+ *  @param userFunction is a pointer to a user callback function, or NULL to disable the overflow interrupt.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the callback was set.
+ *  @note Assumes the FTM has been initialized.
  */
-bool FTM_Init();
+bool FTM_SetOverflowCallback(const TFTMHandle ftm, void (*userFunction)(void*), void* userArguments);
 
 /*! @brief Sets up a timer channel.
  *
+ *  @param ftm The instance.
  *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
  *    channelNb is the channel number of the FTM to use.
  *    delayCount is the delay count (in module clock periods) for an output compare event.
@@ -67,20 +159,89 @@ bool FTM_Init();
  *    ioType is a union that depends on the setting of the channel as input capture or output compare:
  *      outputAction is the action to take on a successful output compare.
  *      inputDetection is the type of input capture detection.
+ *      pwm is the PWM alignment, output pairing, polarity and duty cycle.
+ *        Center-aligned and complementary PWM use the even channel of a pair and its odd neighbour.
  *    callbackFunction is a pointer to a user callback function.
  *    callbackArguments is a pointer to the user arguments to use with the user callback function.
  *  @return bool - TRUE if the timer was set up successfully.
  *  @note Assumes the FTM has been initialized.
  */
-bool FTM_Set(const TFTMChannel* const aFTMChannel);
+bool FTM_Set(const TFTMHandle ftm, const TFTMChannel* const aFTMChannel);
 
 
 /*! @brief Starts a timer if set up for output compare.
  *
+ *  @param ftm The instance.
  *  @param aFTMChannel is a structure containing the parameters to be used in setting up the timer channel.
  *  @return bool - TRUE if the timer was started successfully.
  *  @note Assumes the FTM has been initialized.
  */
-bool FTM_StartTimer(const TFTMChannel* const aFTMChannel);
+bool FTM_StartTimer(const TFTMHandle ftm, const TFTMChannel* const aFTMChannel);
+
+/*! @brief Turns the counter into a PWM time base.
+ *
+ *  The prescaler is chosen for the finest resolution that fits the period, and FTM_Ticks then uses the new counter rate.
+ *  Output compares and the output compare queue cannot be used afterwards, until FTM_Init is called again.
+ *  @param ftm The instance.
+ *  @param period The PWM period in nanoseconds.
+ *  @param deadTime The time both outputs of a complementary pair are inactive at each edge, in nanoseconds (up to 1008 bus clocks).
+ *         It is rounded up to the dead time resolution, so it is never shorter than asked for.
+ *  @return bool - TRUE if the PWM time base was set up, FALSE if the period or dead time is out of range or the queue is in use.
+ *  @note Assumes the FTM has been initialized.
+ */
+bool FTM_PWMInit(const TFTMHandle ftm, const uint32_t period, const uint32_t deadTime);
+
+/*! @brief Changes the duty cycle of a PWM channel.
+ *
+ *  The new duty cycle is loaded at the end of the current period.
+ *  @param ftm The instance.
+ *  @param channelNb The channel set up with FTM_Set for PWM.
+ *  @param dutyCycle Pulse width in hundredths of a percent of the period (0-10000).
+ *  @return bool - TRUE if the channel is a PWM channel.
+ */
+bool FTM_PWMSetDuty(const TFTMHandle ftm, const uint8_t channelNb, const uint16_t dutyCycle);
+
+/*! @brief Overrides PWM outputs with fixed levels, for example to switch a load off at once.
+ *
+ *  The override takes effect at the end of the current period.
+ *  @param ftm The instance.
+ *  @param channelMask A mask of channels - bit n overrides channel n, and a clear bit returns the channel to PWM.
+ *  @param levels The output levels - bit n is the level of channel n.
+ *  @return bool - TRUE if the override was set.
+ */
+bool FTM_PWMOutputControl(const TFTMHandle ftm, const uint8_t channelMask, const uint8_t levels);
+
+/*! @brief Gives channels to the output compare queue.
+ *
+ *  The channels are set up as software output compares and can no longer be used with FTM_Set.
+ *  More channels let more events fall due close together without being late.
+ *  @param ftm The instance.
+ *  @param channelMask A mask of channels - bit n gives channel n to the queue.
+ *  @return bool - TRUE if the queue was set up successfully.
+ *  @note Assumes the FTM has been initialized.
+ */
+bool FTM_QueueInit(const TFTMHandle ftm, const uint8_t channelMask);
+
+/*! @brief Adds an event to the output compare queue.
+ *
+ *  The event is kept in deadline order, and is loaded into a queue channel once it is among the nearest events.
+ *  @param ftm The instance.
+ *  @param delayTicks The delay in counter ticks from now (1 to FTM_QUEUE_MAX_DELAY), from FTM_Ticks.
+ *  @param userFunction is a pointer to the user callback function called from the FTM interrupt at the deadline.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the event was queued, FALSE if the queue is full or a parameter is invalid.
+ *  @note Assumes FTM_QueueInit has been called.
+ */
+bool FTM_QueueAdd(const TFTMHandle ftm, const uint32_t delayTicks, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Interrupt service routines for the FTM instances.
+ *
+ *  Calls the overflow callback, calls the user callback function of each channel that has matched, and runs queued events that are due.
+ *  @note Assumes the FTM has been initialized.
+ */
+void __attribute__ ((interrupt)) FTM0_IRQHandler(void);
+void __attribute__ ((interrupt)) FTM1_IRQHandler(void);
+void __attribute__ ((interrupt)) FTM2_IRQHandler(void);
+void __attribute__ ((interrupt)) FTM3_IRQHandler(void);
 
 #endif
@@ -0,0 +1,952 @@
+/*! @file
+ *
+ *  @brief Routines for erasing and writing to the Flash.
+ *
+ *  This contains the functions needed for accessing the internal Flash.
+ *  Commands are launched through the FTFE Flash Common Command Object registers.
+ *  The data sector is in program flash block 1, so it can be written while code runs from block 0.
+ *  Blocking commands to block 0 itself run with all interrupts masked until they complete.
+ *  Writes to non-volatile variables are collected in a RAM shadow and programmed by Flash_Commit.
+ *  Asynchronous commands are launched from RAM and complete in FTFE_IRQHandler.
+ *
+ *  @author PMcL
+ *  @date 2015-08-07
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "Flash\Flash.h"
+#ifdef FLASH_SIM
+#include "FlashSim\FlashSimRegs.h"
+#else
+#include "Critical\critical.h"
+#include "FMC\FMC.h"
+#include "MK64F12.h"
+#endif
+
+#ifdef FLASH_BENCHMARK
+#include "SWO\SWO.h"
+#endif
+
+// FTFE commands
+#define FLASH_CMD_PGM8   0x07
+#define FLASH_CMD_ERSSCR 0x09
+#define FLASH_CMD_PGMSEC 0x0B
+#define FLASH_CMD_SWAP   0x46
+
+// Places a function in RAM - the start-up code copies .ramfunc with the initialized data
+#ifdef FLASH_SIM
+#define FLASH_RAMFUNC
+#else
+#define FLASH_RAMFUNC __attribute__((section(".ramfunc"), noinline, long_call))
+#endif
+
+// Errors reported in FSTAT
+#define FLASH_FSTAT_ERRORS (FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK | FTFE_FSTAT_MGSTAT0_MASK)
+
+/*!
+ * @struct TFCCOB
+ */
+typedef struct
+{
+  uint8_t command;   /*!< FCCOB0 */
+  uint32_t address;  /*!< FCCOB1 to FCCOB3, a 24-bit Flash address */
+  uint8_t data[8];   /*!< FCCOB4 to FCCOBB */
+} TFCCOB;
+
+#define FLASH_DATA_NB_PHRASES    (FLASH_DATA_SIZE / FLASH_PHRASE_SIZE)
+#define FLASH_DATA_NB_SECTORS    ((FLASH_DATA_SIZE + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE)
+#define FLASH_PHRASES_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PHRASE_SIZE)
+
+#if FLASH_DATA_START % FLASH_SECTOR_SIZE
+#error "FLASH_DATA_START must be on a sector boundary"
+#endif
+
+#if (FLASH_DATA_SIZE == 0) || (FLASH_DATA_SIZE % FLASH_SECTION_ALIGNMENT)
+#error "FLASH_DATA_SIZE must be a non-zero multiple of FLASH_SECTION_ALIGNMENT"
+#endif
+
+#if FLASH_DATA_NB_SECTORS > 32
+#error "Erase bitmap only covers 32 sectors"
+#endif
+
+#define FLASH_ERASED_PHRASE 0xFFFFFFFFFFFFFFFFLLU
+
+// Number of 32-bit words in a bitmap of a number of bits
+#define BITMAP_SIZE(nbBits) (((nbBits) + 31) / 32)
+
+// Bitmap of allocated bytes in the data region
+static uint32_t Allocated[BITMAP_SIZE(FLASH_DATA_SIZE)];
+
+// RAM copy of the data region
+static union
+{
+  uint64_t phrases[FLASH_DATA_NB_PHRASES];
+  uint8_t bytes[FLASH_DATA_SIZE];
+} Shadow;
+
+// Bitmap of phrases changed since the last commit
+static volatile uint32_t Dirty[BITMAP_SIZE(FLASH_DATA_NB_PHRASES)];
+
+// Asynchronous command state
+static volatile bool AsyncBusy;
+static volatile bool AsyncSuccess;
+static void (*UserFunction)(void*);
+static void* UserArguments;
+
+// Asynchronous commit state
+static volatile bool Committing;
+static uint32_t CommitErase;   // Bitmap of sectors still to erase
+static uint32_t CommitPhrase;  // Next phrase to check once all erases are done
+
+/*! @brief Loads a command into the Flash Common Command Object registers.
+ *
+ *  @param commonCommandObject The command and its parameters.
+ */
+static void LoadCommand(const TFCCOB* const commonCommandObject)
+{
+  // Wait for any previous command to complete
+  while (!(FTFE->FSTAT & FTFE_FSTAT_CCIF_MASK))
+    ;
+
+  // Clear old errors (write 1 to clear)
+  FTFE->FSTAT = FTFE_FSTAT_ACCERR_MASK | FTFE_FSTAT_FPVIOL_MASK;
+
+  FTFE->FCCOB0 = commonCommandObject->command;
+  FTFE->FCCOB1 = (uint8_t)(commonCommandObject->address >> 16);
+  FTFE->FCCOB2 = (uint8_t)(commonCommandObject->address >> 8);
+  FTFE->FCCOB3 = (uint8_t)commonCommandObject->address;
+  FTFE->FCCOB4 = commonCommandObject->data[0];
+  FTFE->FCCOB5 = commonCommandObject->data[1];
+  FTFE->FCCOB6 = commonCommandObject->data[2];
+  FTFE->FCCOB7 = commonCommandObject->data[3];
+  FTFE->FCCOB8 = commonCommandObject->data[4];
+  FTFE->FCCOB9 = commonCommandObject->data[5];
+  FTFE->FCCOBA = commonCommandObject->data[6];
+  FTFE->FCCOBB = commonCommandObject->data[7];
+}
+
+/*! @brief Launches the loaded command.
+ *
+ *  Runs from RAM so that no Flash is read between the launch and the completion of a blocking command.
+ *  @param wait TRUE to wait for the command to complete,
+ *              FALSE to return immediately and enable the command complete interrupt.
+ */
+static FLASH_RAMFUNC void Launch(const bool wait)
+{
+  // Write 1 to clear CCIF
+  FTFE->FSTAT = FTFE_FSTAT_CCIF_MASK;
+
+#ifdef FLASH_SIM
+  FlashSim_Launch(wait);
+#endif
+
+  if (wait)
+  {
+    while (!(FTFE->FSTAT & FTFE_FSTAT_CCIF_MASK))
+      ;
+  }
+  else
+  {
+    // CCIF is now clear, so enabling the interrupt does not trigger it immediately
+    FTFE->FCNFG |= FTFE_FCNFG_CCIE_MASK;
+  }
+}
+
+/*! @brief Invalidates the FMC cache and prefetch buffers.
+ *
+ *  The FMC may hold stale copies of the old contents after an erase or program.
+ */
+static void InvalidateCache(void)
+{
+#ifndef FLASH_SIM
+  FMC_Invalidate();
+#endif
+}
+
+/*! @brief Waits for any asynchronous command to finish.
+ *
+ *  @return bool - TRUE if no asynchronous command is in progress,
+ *                 FALSE if one is and the caller is an interrupt handler, which could block FTFE_IRQHandler forever.
+ */
+static bool WaitAsync(void)
+{
+  if (AsyncBusy && __get_IPSR())
+    return false;
+
+  while (AsyncBusy)
+    ;
+
+  return true;
+}
+
+/*! @brief Launches a Flash command and waits for it to complete.
+ *
+ *  A command to block 0 runs with all interrupts masked, since a vector or handler fetched from block 0
+ *  before it completes would be a read collision.
+ *  @param commonCommandObject The command and its parameters.
+ *  @return bool - TRUE if the command completed without an error,
+ *                 FALSE if it failed or was called from an interrupt while an asynchronous command is in progress.
+ */
+static bool LaunchCommand(const TFCCOB* const commonCommandObject)
+{
+  const bool block0 = (commonCommandObject->address < FLASH_BLOCK_SIZE);
+  bool success;
+
+  for (;;)
+  {
+    if (!WaitAsync())
+      return false;
+    if (!block0)
+      break;
+
+    // An interrupt may have launched an asynchronous command since the wait
+    EnterCritical();
+    if (!AsyncBusy)
+      break;
+    ExitCritical();
+  }
+
+  LoadCommand(commonCommandObject);
+  Launch(true);
+  InvalidateCache();
+  success = !(FTFE->FSTAT & FLASH_FSTAT_ERRORS);
+
+  if (block0)
+    ExitCritical();
+
+  return success;
+}
+
+/*! @brief Launches the next command of an asynchronous operation that is already in progress.
+ *
+ *  @param commonCommandObject The command and its parameters.
+ */
+static void LaunchNext(const TFCCOB* const commonCommandObject)
+{
+  LoadCommand(commonCommandObject);
+  Launch(false);
+}
+
+/*! @brief Launches a Flash command without waiting for it to complete.
+ *
+ *  @param commonCommandObject The command and its parameters.
+ *  @return bool - TRUE if the command was launched, FALSE if another asynchronous command is in progress.
+ */
+static bool LaunchCommandAsync(const TFCCOB* const commonCommandObject)
+{
+  if (AsyncBusy)
+    return false;
+
+  AsyncBusy = true;
+  LaunchNext(commonCommandObject);
+
+  return true;
+}
+
+/*! @brief Fills in a Program Phrase command.
+ */
+static void PhraseCommand(TFCCOB* const fccob, const uint32_t address, const uint64_t phrase)
+{
+  uint64union_t data;
+
+  data.l = phrase;
+  fccob->command = FLASH_CMD_PGM8;
+  fccob->address = address;
+
+  // Each word is loaded most significant byte first
+  fccob->data[0] = (uint8_t)(data.s.Lo >> 24);
+  fccob->data[1] = (uint8_t)(data.s.Lo >> 16);
+  fccob->data[2] = (uint8_t)(data.s.Lo >> 8);
+  fccob->data[3] = (uint8_t)data.s.Lo;
+  fccob->data[4] = (uint8_t)(data.s.Hi >> 24);
+  fccob->data[5] = (uint8_t)(data.s.Hi >> 16);
+  fccob->data[6] = (uint8_t)(data.s.Hi >> 8);
+  fccob->data[7] = (uint8_t)data.s.Hi;
+}
+
+/*! @brief Fills in an Erase Flash Sector command.
+ */
+static void SectorCommand(TFCCOB* const fccob, const uint32_t address)
+{
+  fccob->command = FLASH_CMD_ERSSCR;
+  fccob->address = address & ~(uint32_t)(FLASH_SECTOR_SIZE - 1);
+  for (uint8_t i = 0; i < sizeof(fccob->data); i++)
+    fccob->data[i] = 0;
+}
+
+/*! @brief Tests a bit in a bitmap.
+ */
+static bool BitTest(const volatile uint32_t* const bitmap, const uint32_t bit)
+{
+  return (bitmap[bit / 32] & (1LU << (bit % 32))) != 0;
+}
+
+/*! @brief Sets a bit in a bitmap.
+ */
+static void BitSet(volatile uint32_t* const bitmap, const uint32_t bit)
+{
+  bitmap[bit / 32] |= 1LU << (bit % 32);
+}
+
+/*! @brief Clears a bit in a bitmap.
+ */
+static void BitClear(volatile uint32_t* const bitmap, const uint32_t bit)
+{
+  bitmap[bit / 32] &= ~(1LU << (bit % 32));
+}
+
+/*! @brief Gets the Flash address of a phrase of the data region.
+ */
+static uint32_t PhraseAddress(const uint32_t phrase)
+{
+  return FLASH_DATA_START + phrase * FLASH_PHRASE_SIZE;
+}
+
+/*! @brief Checks whether a phrase is blank in Flash but not in the shadow.
+ */
+static bool Programmable(const uint32_t phrase)
+{
+  return (_FP(PhraseAddress(phrase)) == FLASH_ERASED_PHRASE) && (Shadow.phrases[phrase] != FLASH_ERASED_PHRASE);
+}
+
+/*! @brief Checks whether committing the shadow needs a sector of the data region to be erased.
+ *
+ *  Bits can only be programmed from 1 to 0, and a phrase can only be programmed once between erases.
+ *  @param sector The sector number within the data region.
+ */
+static bool SectorNeedsErase(const uint32_t sector)
+{
+  uint32_t phrase, end;
+
+  end = (sector + 1) * FLASH_PHRASES_PER_SECTOR;
+  if (end > FLASH_DATA_NB_PHRASES)
+    end = FLASH_DATA_NB_PHRASES;
+
+  for (phrase = sector * FLASH_PHRASES_PER_SECTOR; phrase < end; phrase++)
+  {
+    if (BitTest(Dirty, phrase)
+        && (_FP(PhraseAddress(phrase)) != Shadow.phrases[phrase])
+        && (_FP(PhraseAddress(phrase)) != FLASH_ERASED_PHRASE))
+      return true;
+  }
+
+  return false;
+}
+
+/*! @brief Programs every blank phrase of a sector of the data region that has data in the shadow.
+ *
+ *  Runs of 16-byte units with both phrases to program use one Program Section command,
+ *  unless the FlexRAM is not available as RAM, in which case every phrase is programmed on its own.
+ *  Phrases that are blank in the shadow are never programmed, so they can still be programmed later without an erase.
+ *  @param sector The sector number within the data region.
+ */
+static bool ProgramSector(const uint32_t sector)
+{
+  const uint32_t phrasesPerUnit = FLASH_SECTION_ALIGNMENT / FLASH_PHRASE_SIZE;
+  const bool section = (FTFE->FCNFG & FTFE_FCNFG_RAMRDY_MASK) != 0;
+  uint32_t phrase, run, end;
+
+  end = (sector + 1) * FLASH_PHRASES_PER_SECTOR;
+  if (end > FLASH_DATA_NB_PHRASES)
+    end = FLASH_DATA_NB_PHRASES;
+
+  phrase = sector * FLASH_PHRASES_PER_SECTOR;
+  while (phrase < end)
+  {
+    if (!Programmable(phrase))
+    {
+      phrase++;
+      continue;
+    }
+
+    // The data region starts on a sector boundary, so unit boundaries are at multiples of phrasesPerUnit
+    run = phrase;
+    if (section && (phrase % phrasesPerUnit == 0))
+    {
+      while ((run + phrasesPerUnit <= end) && Programmable(run) && Programmable(run + 1))
+        run += phrasesPerUnit;
+    }
+
+    if (run > phrase)
+    {
+      if (!Flash_WriteSection(PhraseAddress(phrase), &Shadow.phrases[phrase], (run - phrase) * FLASH_PHRASE_SIZE))
+        return false;
+      phrase = run;
+    }
+    else
+    {
+      if (!Flash_ProgramPhrase(PhraseAddress(phrase), Shadow.phrases[phrase]))
+        return false;
+      phrase++;
+    }
+  }
+
+  return true;
+}
+
+/*! @brief Marks every phrase of a sector of the data region dirty.
+ *
+ *  @param sector The sector number within the data region.
+ */
+static void SectorSetDirty(const uint32_t sector)
+{
+  uint32_t end;
+
+  end = (sector + 1) * FLASH_PHRASES_PER_SECTOR;
+  if (end > FLASH_DATA_NB_PHRASES)
+    end = FLASH_DATA_NB_PHRASES;
+
+  EnterCritical();
+  for (uint32_t phrase = sector * FLASH_PHRASES_PER_SECTOR; phrase < end; phrase++)
+    BitSet(Dirty, phrase);
+  ExitCritical();
+}
+
+/*! @brief Programs the changes in the shadow to a sector of the data region.
+ *
+ *  The sector is erased first if any change cannot be programmed over the Flash contents.
+ *  @param sector The sector number within the data region.
+ */
+static bool CommitSector(const uint32_t sector)
+{
+  uint32_t end;
+  bool erase;
+
+  end = (sector + 1) * FLASH_PHRASES_PER_SECTOR;
+  if (end > FLASH_DATA_NB_PHRASES)
+    end = FLASH_DATA_NB_PHRASES;
+
+  // Writes made while the sector is being committed mark their phrases dirty again
+  EnterCritical();
+  erase = SectorNeedsErase(sector);
+  for (uint32_t phrase = sector * FLASH_PHRASES_PER_SECTOR; phrase < end; phrase++)
+    BitClear(Dirty, phrase);
+  ExitCritical();
+
+  if ((erase && !Flash_EraseSector(FLASH_DATA_START + sector * FLASH_SECTOR_SIZE)) || !ProgramSector(sector))
+  {
+    SectorSetDirty(sector);
+    return false;
+  }
+
+  return true;
+}
+
+/*! @brief Ends an asynchronous commit and calls the user callback.
+ *
+ *  @param success TRUE if every phrase was programmed.
+ */
+static void CommitFinish(const bool success)
+{
+  // Make the next commit re-examine every phrase
+  if (!success)
+  {
+    for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_NB_PHRASES); word++)
+      Dirty[word] = ~0u;
+  }
+
+  Committing = false;
+  AsyncSuccess = success;
+  AsyncBusy = false;
+
+  if (UserFunction)
+    UserFunction(UserArguments);
+}
+
+/*! @brief Launches the next command of an asynchronous commit.
+ *
+ *  Sectors that need it are erased first, then each phrase is programmed.
+ *  Only blank phrases are programmed - a phrase that was already programmed and has changed again since
+ *  the commit started stays dirty for the next commit.
+ */
+static void CommitStep(void)
+{
+  TFCCOB fccob;
+
+  if (!AsyncSuccess)
+  {
+    CommitFinish(false);
+    return;
+  }
+
+  if (CommitErase)
+  {
+    uint32_t sector = 31u - __CLZ(CommitErase);
+
+    CommitErase &= ~(1LU << sector);
+    SectorCommand(&fccob, FLASH_DATA_START + sector * FLASH_SECTOR_SIZE);
+    LaunchNext(&fccob);
+    return;
+  }
+
+  while (CommitPhrase < FLASH_DATA_NB_PHRASES)
+  {
+    if (Programmable(CommitPhrase))
+    {
+      PhraseCommand(&fccob, PhraseAddress(CommitPhrase), Shadow.phrases[CommitPhrase]);
+      CommitPhrase++;
+      LaunchNext(&fccob);
+      return;
+    }
+
+    CommitPhrase++;
+  }
+
+  CommitFinish(true);
+}
+
+/*! @brief Finds the shadow copy of a non-volatile variable and marks it dirty.
+ *
+ *  @param address The address of the data, in the RAM shadow or the Flash data region.
+ *  @param size The size of the data in bytes.
+ *  @param alignment The required alignment of the data in bytes, which must be a power of 2.
+ *  @return uint8_t* - the address in the shadow, or NULL if the address is out of range or misaligned.
+ */
+static uint8_t* ShadowAddress(const uintptr_t address, const uint16_t size, const uint8_t alignment)
+{
+  uint32_t offset;
+
+  if ((address >= FLASH_DATA_START) && (address <= FLASH_DATA_END))
+    offset = address - FLASH_DATA_START;
+  else if ((address >= (uintptr_t)Shadow.bytes) && (address < (uintptr_t)Shadow.bytes + FLASH_DATA_SIZE))
+    offset = address - (uintptr_t)Shadow.bytes;
+  else
+    return NULL;
+
+  if ((offset & (alignment - 1)) || (size == 0) || (offset + size > FLASH_DATA_SIZE))
+    return NULL;
+
+  // A failed asynchronous commit marks every phrase dirty from the interrupt
+  EnterCritical();
+  for (uint32_t phrase = offset / FLASH_PHRASE_SIZE; phrase <= (offset + size - 1) / FLASH_PHRASE_SIZE; phrase++)
+    BitSet(Dirty, phrase);
+  ExitCritical();
+
+  return &Shadow.bytes[offset];
+}
+
+bool Flash_Init(void)
+{
+  for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_SIZE); word++)
+    Allocated[word] = 0;
+  for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_NB_PHRASES); word++)
+    Dirty[word] = 0;
+  AsyncBusy = false;
+  Committing = false;
+
+  NVIC_SetPriority(FTFE_IRQn, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_ClearPendingIRQ(FTFE_IRQn);
+  NVIC_EnableIRQ(FTFE_IRQn);
+
+  memcpy(Shadow.bytes, (const void*)&_FB(FLASH_DATA_START), FLASH_DATA_SIZE);
+
+  return true;
+}
+
+bool Flash_AllocateVar(volatile void** variable, const uint16_t size)
+{
+  uint16_t alignment, offset, i;
+
+  if ((size == 0) || (size > FLASH_DATA_SIZE))
+    return false;
+
+  // Scalars are naturally aligned, anything else starts on a phrase
+  alignment = ((size == 1) || (size == 2) || (size == 4)) ? size : FLASH_PHRASE_SIZE;
+
+  for (offset = 0; offset + size <= FLASH_DATA_SIZE; offset += alignment)
+  {
+    for (i = 0; (i < size) && !BitTest(Allocated, offset + i); i++)
+      ;
+
+    if (i == size)
+    {
+      for (i = 0; i < size; i++)
+        BitSet(Allocated, offset + i);
+      *variable = &Shadow.bytes[offset];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool Flash_Write32(volatile uint32_t* const address, const uint32_t data)
+{
+  uint32_t* shadow = (uint32_t*)ShadowAddress((uintptr_t)address, 4, 4);
+
+  if (!shadow)
+    return false;
+
+  *shadow = data;
+  return true;
+}
+
+bool Flash_Write16(volatile uint16_t* const address, const uint16_t data)
+{
+  uint16_t* shadow = (uint16_t*)ShadowAddress((uintptr_t)address, 2, 2);
+
+  if (!shadow)
+    return false;
+
+  *shadow = data;
+  return true;
+}
+
+bool Flash_Write8(volatile uint8_t* const address, const uint8_t data)
+{
+  uint8_t* shadow = ShadowAddress((uintptr_t)address, 1, 1);
+
+  if (!shadow)
+    return false;
+
+  *shadow = data;
+  return true;
+}
+
+bool Flash_WriteBlock(volatile void* const address, const void* const data, const uint16_t size)
+{
+  uint8_t* shadow = ShadowAddress((uintptr_t)address, size, 1);
+  uint32_t offset;
+
+  if (!shadow)
+    return false;
+
+  memcpy(shadow, data, size);
+
+  offset = (uint32_t)(shadow - Shadow.bytes);
+  for (uint32_t sector = offset / FLASH_SECTOR_SIZE; sector <= (offset + size - 1) / FLASH_SECTOR_SIZE; sector++)
+  {
+    if (!CommitSector(sector))
+      return false;
+  }
+
+  return true;
+}
+
+bool Flash_Erase(void)
+{
+  for (uint32_t phrase = 0; phrase < FLASH_DATA_NB_PHRASES; phrase++)
+    Shadow.phrases[phrase] = FLASH_ERASED_PHRASE;
+  for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_NB_PHRASES); word++)
+    Dirty[word] = 0;
+
+  for (uint32_t sector = 0; sector < FLASH_DATA_NB_SECTORS; sector++)
+  {
+    if (!Flash_EraseSector(FLASH_DATA_START + sector * FLASH_SECTOR_SIZE))
+      return false;
+  }
+
+  return true;
+}
+
+bool Flash_Commit(void)
+{
+  for (uint32_t sector = 0; sector < FLASH_DATA_NB_SECTORS; sector++)
+  {
+    if (!CommitSector(sector))
+      return false;
+  }
+
+  return true;
+}
+
+bool Flash_CommitAsync(void (*userFunction)(void*), void* userArguments)
+{
+  if (AsyncBusy)
+    return false;
+
+  // Writes made while the commit is in progress mark their phrases dirty again
+  EnterCritical();
+  CommitErase = 0;
+  for (uint32_t sector = 0; sector < FLASH_DATA_NB_SECTORS; sector++)
+  {
+    if (SectorNeedsErase(sector))
+      CommitErase |= 1LU << sector;
+  }
+  for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_NB_PHRASES); word++)
+    Dirty[word] = 0;
+  ExitCritical();
+
+  UserFunction = userFunction;
+  UserArguments = userArguments;
+  CommitPhrase = 0;
+  Committing = true;
+  AsyncSuccess = true;
+
+  CommitStep();
+  return true;
+}
+
+bool Flash_IsDirty(void)
+{
+  for (uint32_t word = 0; word < BITMAP_SIZE(FLASH_DATA_NB_PHRASES); word++)
+  {
+    if (Dirty[word])
+      return true;
+  }
+
+  return false;
+}
+
+bool Flash_ProgramPhrase(const uint32_t address, const uint64_t phrase)
+{
+  TFCCOB fccob;
+
+  if (address & (FLASH_PHRASE_SIZE - 1))
+    return false;
+
+  PhraseCommand(&fccob, address, phrase);
+  return LaunchCommand(&fccob);
+}
+
+bool Flash_EraseSector(const uint32_t address)
+{
+  TFCCOB fccob;
+
+  SectorCommand(&fccob, address);
+  return LaunchCommand(&fccob);
+}
+
+bool Flash_WriteSection(const uint32_t address, const void* const data, const uint32_t size)
+{
+  const uint8_t* source = (const uint8_t*)data;
+  volatile uint32_t* flexRAM = &_FW(FLASH_FLEXRAM_START);
+  uint32_t done, pass;
+  uint32union_t word;
+  TFCCOB fccob;
+
+  if ((address & (FLASH_SECTION_ALIGNMENT - 1)) || (size & (FLASH_SECTION_ALIGNMENT - 1)))
+    return false;
+
+  // FlexRAM must be available as RAM rather than EEPROM
+  if (!(FTFE->FCNFG & FTFE_FCNFG_RAMRDY_MASK))
+    return false;
+
+  for (done = 0; done < size; done += pass)
+  {
+    // One pass per sector, limited by the size of the FlexRAM
+    pass = FLASH_SECTOR_SIZE - ((address + done) & (FLASH_SECTOR_SIZE - 1));
+    if (pass > size - done)
+      pass = size - done;
+    if (pass > FLASH_FLEXRAM_SIZE)
+      pass = FLASH_FLEXRAM_SIZE;
+
+    // Wait until the previous command releases the FlexRAM
+    if (!WaitAsync())
+      return false;
+    while (!(FTFE->FSTAT & FTFE_FSTAT_CCIF_MASK))
+      ;
+
+    // FlexRAM only supports aligned accesses, and the source may not be aligned
+    for (uint32_t i = 0; i < pass; i += 4)
+    {
+      word.s.Lo = (uint16_t)(source[done + i] | (source[done + i + 1] << 8));
+      word.s.Hi = (uint16_t)(source[done + i + 2] | (source[done + i + 3] << 8));
+      flexRAM[i / 4] = word.l;
+    }
+
+    fccob.command = FLASH_CMD_PGMSEC;
+    fccob.address = address + done;
+    for (uint8_t i = 0; i < sizeof(fccob.data); i++)
+      fccob.data[i] = 0;
+
+    // Number of 128-bit units, most significant byte first
+    fccob.data[0] = (uint8_t)((pass / FLASH_SECTION_ALIGNMENT) >> 8);
+    fccob.data[1] = (uint8_t)(pass / FLASH_SECTION_ALIGNMENT);
+
+    if (!LaunchCommand(&fccob))
+      return false;
+  }
+
+  return true;
+}
+
+bool Flash_SwapControl(const uint32_t indicatorAddress, const TFlashSwapControl control, TFlashSwapMode* const mode)
+{
+  TFCCOB fccob;
+
+  fccob.command = FLASH_CMD_SWAP;
+  fccob.address = indicatorAddress;
+  for (uint8_t i = 0; i < sizeof(fccob.data); i++)
+    fccob.data[i] = 0;
+  fccob.data[0] = (uint8_t)control;
+
+  if (!LaunchCommand(&fccob))
+    return false;
+
+  // The current swap mode is returned in FCCOB5
+  if (mode)
+    *mode = (TFlashSwapMode)FTFE->FCCOB5;
+
+  return true;
+}
+
+bool Flash_ProgramPhraseAsync(const uint32_t address, const uint64_t phrase, void (*userFunction)(void*), void* userArguments)
+{
+  TFCCOB fccob;
+
+  if ((address & (FLASH_PHRASE_SIZE - 1)) || (address < FLASH_BLOCK_SIZE) || AsyncBusy)
+    return false;
+
+  UserFunction = userFunction;
+  UserArguments = userArguments;
+  PhraseCommand(&fccob, address, phrase);
+  return LaunchCommandAsync(&fccob);
+}
+
+bool Flash_EraseSectorAsync(const uint32_t address, void (*userFunction)(void*), void* userArguments)
+{
+  TFCCOB fccob;
+
+  if ((address < FLASH_BLOCK_SIZE) || AsyncBusy)
+    return false;
+
+  UserFunction = userFunction;
+  UserArguments = userArguments;
+  SectorCommand(&fccob, address);
+  return LaunchCommandAsync(&fccob);
+}
+
+bool Flash_IsBusy(void)
+{
+  return AsyncBusy;
+}
+
+bool Flash_AsyncSucceeded(void)
+{
+  return AsyncSuccess;
+}
+
+void FLASH_ISR FTFE_IRQHandler(void)
+{
+  // CCIF cannot be cleared without launching a command, so disable the interrupt instead
+  FTFE->FCNFG &= ~FTFE_FCNFG_CCIE_MASK;
+  InvalidateCache();
+
+  AsyncSuccess = !(FTFE->FSTAT & FLASH_FSTAT_ERRORS);
+
+  if (Committing)
+  {
+    CommitStep();
+    return;
+  }
+
+  AsyncBusy = false;
+  if (UserFunction)
+    UserFunction(UserArguments);
+}
+
+#ifdef FLASH_BENCHMARK
+
+#if FLASH_BENCHMARK_ADDRESS % FLASH_SECTOR_SIZE
+#error "FLASH_BENCHMARK_ADDRESS must be on a sector boundary"
+#endif
+
+#if (FLASH_BENCHMARK_ADDRESS <= FLASH_DATA_END) && (FLASH_BENCHMARK_ADDRESS + FLASH_SECTOR_SIZE > FLASH_DATA_START)
+#error "FLASH_BENCHMARK_ADDRESS must not overlap the data region"
+#endif
+
+// Number of times each method is timed
+#define FLASH_BENCHMARK_NB_RUNS 4
+
+// Data programmed by each run
+static uint64_t BenchmarkData[FLASH_PHRASES_PER_SECTOR];
+
+/*! @brief Erases the benchmark sector and checks that it is blank.
+ */
+static bool BenchmarkErase(void)
+{
+  if (!Flash_EraseSector(FLASH_BENCHMARK_ADDRESS))
+    return false;
+
+  for (uint32_t phrase = 0; phrase < FLASH_PHRASES_PER_SECTOR; phrase++)
+  {
+    if (_FP(FLASH_BENCHMARK_ADDRESS + phrase * FLASH_PHRASE_SIZE) != FLASH_ERASED_PHRASE)
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Checks that the benchmark sector holds the benchmark data.
+ */
+static bool BenchmarkCheck(void)
+{
+  for (uint32_t phrase = 0; phrase < FLASH_PHRASES_PER_SECTOR; phrase++)
+  {
+    if (_FP(FLASH_BENCHMARK_ADDRESS + phrase * FLASH_PHRASE_SIZE) != BenchmarkData[phrase])
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Writes one benchmark result to ITM stimulus port 0.
+ */
+static void BenchmarkReport(const char* const name, const uint32_t cycles)
+{
+  SWO_PutString("Flash ");
+  SWO_PutString(name);
+  SWO_PutString(": ");
+  SWO_PutNumber(cycles);
+  SWO_PutString(" cycles, ");
+  SWO_PutNumber(cycles ? (uint32_t)(((uint64_t)FLASH_SECTOR_SIZE * SystemCoreClock) / cycles) : 0);
+  SWO_PutString(" bytes/s\n");
+}
+
+bool Flash_Benchmark(TFlashBenchmarkResult* const result)
+{
+  TFlashBenchmarkResult best = {~0u, ~0u};
+  uint32_t start, cycles;
+  bool success;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  // No phrase of the data is blank, so every phrase is programmed
+  for (uint32_t phrase = 0; phrase < FLASH_PHRASES_PER_SECTOR; phrase++)
+    BenchmarkData[phrase] = ((uint64_t)~phrase << 32) | phrase;
+
+  for (uint8_t run = 0; run < FLASH_BENCHMARK_NB_RUNS; run++)
+  {
+    if (!BenchmarkErase())
+      return false;
+
+    start = DWT->CYCCNT;
+    for (uint32_t phrase = 0; phrase < FLASH_PHRASES_PER_SECTOR; phrase++)
+    {
+      if (!Flash_ProgramPhrase(FLASH_BENCHMARK_ADDRESS + phrase * FLASH_PHRASE_SIZE, BenchmarkData[phrase]))
+        return false;
+    }
+    cycles = DWT->CYCCNT - start;
+
+    if (!BenchmarkCheck())
+      return false;
+    if (cycles < best.phraseCycles)
+      best.phraseCycles = cycles;
+
+    if (!BenchmarkErase())
+      return false;
+
+    start = DWT->CYCCNT;
+    success = Flash_WriteSection(FLASH_BENCHMARK_ADDRESS, BenchmarkData, FLASH_SECTOR_SIZE);
+    cycles = DWT->CYCCNT - start;
+
+    if (!success || !BenchmarkCheck())
+      return false;
+    if (cycles < best.sectionCycles)
+      best.sectionCycles = cycles;
+  }
+
+  BenchmarkReport("phrase", best.phraseCycles);
+  BenchmarkReport("section", best.sectionCycles);
+
+  if (result)
+    *result = best;
+
+  return BenchmarkErase();
+}
+
+#endif
@@ -3,6 +3,16 @@
  *  @brief Routines for erasing and writing to the Flash.
  *
  *  This contains the functions needed for accessing the internal Flash.
+ *  Non-volatile variables live in a RAM shadow of the data region, loaded by Flash_Init.
+ *  Flash_Write functions only update the shadow; Flash_Commit programs every change in one pass,
+ *  erasing each sector of the data region at most once.
+ *  Variables can be any size, so a configuration struct can be allocated and written as one block.
+ *  The Async functions return as soon as the command is launched and call the user callback from FTFE_IRQHandler,
+ *  so the main loop keeps running during a sector erase. Only one asynchronous operation can be in progress.
+ *  A blocking function called from an interrupt handler while one is in progress returns FALSE instead of waiting for it.
+ *  Blocking commands to block 0, where code and the vector table are read from, mask all interrupts until they complete,
+ *  which can be a whole sector erase. The Async functions only accept block 1 addresses.
+ *  Defining FLASH_BENCHMARK adds Flash_Benchmark, which times phrase programming against Program Section commands.
  *
  *  @author PMcL
  *  @date 2015-08-07
@@ -15,18 +25,72 @@
 #include "Types\types.h"
 
 // FLASH data access
+#ifdef FLASH_SIM
+// Host build - Flash is a RAM image
+#include "FlashSim\FlashSim.h"
+#define _FB(flashAddress)  *(uint8_t  volatile *)FlashSim_Address(flashAddress)
+#define _FH(flashAddress)  *(uint16_t volatile *)FlashSim_Address(flashAddress)
+#define _FW(flashAddress)  *(uint32_t volatile *)FlashSim_Address(flashAddress)
+#define _FP(flashAddress)  *(uint64_t volatile *)FlashSim_Address(flashAddress)
+#else
 #define _FB(flashAddress)  *(uint8_t  volatile *)(flashAddress)
 #define _FH(flashAddress)  *(uint16_t volatile *)(flashAddress)
 #define _FW(flashAddress)  *(uint32_t volatile *)(flashAddress)
 #define _FP(flashAddress)  *(uint64_t volatile *)(flashAddress)
+#endif
+
+// Size of each program flash block - code runs from block 0, so only block 1 can be written while interrupts run
+#define FLASH_BLOCK_SIZE 0x00080000LU
 
-// Address of the start of the Flash block we are using for data storage
-#define FLASH_DATA_START 0x00080000LU
+// Address of the start of the Flash block we are using for data storage, on a sector boundary
+// It is in the area at the top of block 1 that firmware updates leave alone
+#define FLASH_DATA_START 0x000F0000LU
+// Size of the Flash data region in bytes, a multiple of 16 - it may span several sectors and is shadowed in RAM
+#ifndef FLASH_DATA_SIZE
+#define FLASH_DATA_SIZE  256
+#endif
 // Address of the end of the Flash block we are using for data storage
-#define FLASH_DATA_END   0x00080007LU
+#define FLASH_DATA_END   (FLASH_DATA_START + FLASH_DATA_SIZE - 1)
+
+// Size of a Flash sector, the smallest erasable unit
+#define FLASH_SECTOR_SIZE 4096
+// Size of a Flash phrase, the smallest programmable unit
+#define FLASH_PHRASE_SIZE 8
+
+// FlexRAM, used to stage data for Program Section commands
+#define FLASH_FLEXRAM_START 0x14000000LU
+#define FLASH_FLEXRAM_SIZE  4096
+// Alignment of the address and size of a Program Section command
+#define FLASH_SECTION_ALIGNMENT 16
+
+/*!
+ * @enum TFlashSwapControl
+ *  Swap Control command codes.
+ */
+typedef enum
+{
+  FLASH_SWAP_INIT         = 0x01,  /*!< Initialize the swap system with the swap indicator address */
+  FLASH_SWAP_SET_UPDATE   = 0x02,  /*!< Start a new update from the Ready state */
+  FLASH_SWAP_SET_COMPLETE = 0x04,  /*!< Swap the blocks at the next reset */
+  FLASH_SWAP_REPORT       = 0x08   /*!< Report the swap state only */
+} TFlashSwapControl;
+
+/*!
+ * @enum TFlashSwapMode
+ *  Swap system states.
+ */
+typedef enum
+{
+  FLASH_SWAP_UNINITIALIZED = 0x00,
+  FLASH_SWAP_READY         = 0x01,
+  FLASH_SWAP_UPDATE        = 0x02,  /*!< The inactive swap indicator must be erased next */
+  FLASH_SWAP_UPDATE_ERASED = 0x03,  /*!< The inactive block can be programmed */
+  FLASH_SWAP_COMPLETE      = 0x04   /*!< The blocks swap at the next reset */
+} TFlashSwapMode;
 
 /*! @brief Enables the Flash module.
  *
+ *  Loads the RAM shadow from the Flash data region.
  *  @return bool - TRUE if the Flash was setup successfully.
  */
 bool Flash_Init(void);
@@ -34,50 +98,210 @@ bool Flash_Init(void);
 /*! @brief Allocates space for a non-volatile variable in the Flash memory.
  *
  *  @param variable is the address of a pointer to a variable that is to be allocated space in Flash memory.
- *         The pointer will be allocated to a relevant address:
+ *         The pointer will be allocated to a relevant address in the RAM shadow, so reads always see the latest write:
  *         If the variable is a byte, then any address.
  *         If the variable is a half-word, then an even address.
  *         If the variable is a word, then an address divisible by 4.
+ *         Otherwise an address divisible by 8, the start of a phrase.
  *         This allows the resulting variable to be used with the relevant Flash_Write function which assumes a certain memory address.
  *         e.g. a 16-bit variable will be on an even address
- *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory. Valid values are 1, 2 and 4.
+ *  @param size The size, in bytes, of the variable that is to be allocated space in the Flash memory, from 1 to FLASH_DATA_SIZE.
  *  @return bool - TRUE if the variable was allocated space in the Flash memory.
  *  @note Assumes Flash has been initialized.
  */
-bool Flash_AllocateVar(volatile void** variable, const uint8_t size);
+bool Flash_AllocateVar(volatile void** variable, const uint16_t size);
 
 /*! @brief Writes a 32-bit number to Flash.
  *
- *  @param address The address of the data.
+ *  @param address The address of the data, in the RAM shadow or the Flash data region.
  *  @param data The 32-bit data to write.
- *  @return bool - TRUE if Flash was written successfully, FALSE if address is not aligned to a 4-byte boundary or if there is a programming error.
- *  @note Assumes Flash has been initialized.
+ *  @return bool - TRUE if the shadow was written successfully, FALSE if address is not aligned to a 4-byte boundary or not in the data region.
+ *  @note Assumes Flash has been initialized. The data is not persistent until Flash_Commit is called.
  */
 bool Flash_Write32(volatile uint32_t* const address, const uint32_t data);
  
 /*! @brief Writes a 16-bit number to Flash.
  *
- *  @param address The address of the data.
+ *  @param address The address of the data, in the RAM shadow or the Flash data region.
  *  @param data The 16-bit data to write.
- *  @return bool - TRUE if Flash was written successfully, FALSE if address is not aligned to a 2-byte boundary or if there is a programming error.
- *  @note Assumes Flash has been initialized.
+ *  @return bool - TRUE if the shadow was written successfully, FALSE if address is not aligned to a 2-byte boundary or not in the data region.
+ *  @note Assumes Flash has been initialized. The data is not persistent until Flash_Commit is called.
  */
 bool Flash_Write16(volatile uint16_t* const address, const uint16_t data);
 
 /*! @brief Writes an 8-bit number to Flash.
  *
- *  @param address The address of the data.
+ *  @param address The address of the data, in the RAM shadow or the Flash data region.
  *  @param data The 8-bit data to write.
- *  @return bool - TRUE if Flash was written successfully, FALSE if there is a programming error.
- *  @note Assumes Flash has been initialized.
+ *  @return bool - TRUE if the shadow was written successfully, FALSE if address is not in the data region.
+ *  @note Assumes Flash has been initialized. The data is not persistent until Flash_Commit is called.
  */
 bool Flash_Write8(volatile uint8_t* const address, const uint8_t data);
 
-/*! @brief Erases the entire Flash sector.
+/*! @brief Writes a block of data, such as a struct, to Flash.
  *
- *  @return bool - TRUE if the Flash "data" sector was erased successfully.
+ *  The block is copied into the RAM shadow and committed at once, so it is never left half-written by a later commit.
+ *  Only the sectors the block touches are committed, along with any other changes in them;
+ *  changes in the rest of the data region wait for Flash_Commit.
+ *  @param address The address of the block, in the RAM shadow or the Flash data region.
+ *  @param data A pointer to the data to write.
+ *  @param size The number of bytes to write.
+ *  @return bool - TRUE if the block was written and committed successfully, FALSE if the block is not in the data region.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_WriteBlock(volatile void* const address, const void* const data, const uint16_t size);
+
+/*! @brief Erases every Flash sector of the data region.
+ *
+ *  The RAM shadow is also set to the erased state.
+ *  @return bool - TRUE if the Flash "data" sectors were erased successfully.
  *  @note Assumes Flash has been initialized.
  */
 bool Flash_Erase(void);
 
+/*! @brief Programs all changes in the RAM shadow to Flash.
+ *
+ *  Changed phrases that are still erased in Flash are programmed directly.
+ *  Otherwise their sector is erased once and every non-blank phrase is reprogrammed,
+ *  with runs of 16-byte units written by Program Section commands if the FlexRAM is available as RAM.
+ *  Call on demand, periodically, or before entering a low-power mode.
+ *  @return bool - TRUE if there was nothing to do or the changes were programmed successfully.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_Commit(void);
+
+/*! @brief Checks whether the RAM shadow has uncommitted changes.
+ *
+ *  @return bool - TRUE if Flash_Commit has work to do.
+ */
+bool Flash_IsDirty(void);
+
+/*! @brief Programs one phrase of Flash.
+ *
+ *  @param address The address of the phrase, which must be aligned to an 8-byte boundary.
+ *  @param phrase The 64-bit data to program, with the byte at address in the least significant byte.
+ *  @return bool - TRUE if the phrase was programmed successfully.
+ *  @note Assumes Flash has been initialized and the phrase has been erased.
+ */
+bool Flash_ProgramPhrase(const uint32_t address, const uint64_t phrase);
+
+/*! @brief Erases one Flash sector.
+ *
+ *  @param address Any address in the sector to erase.
+ *  @return bool - TRUE if the sector was erased successfully.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_EraseSector(const uint32_t address);
+
+/*! @brief Programs a block of Flash using Program Section commands.
+ *
+ *  The data is staged in FlexRAM and programmed with one command per sector (up to 4 KB),
+ *  instead of one command and one completion wait per phrase.
+ *  @param address The Flash address to program, which must be aligned to a 16-byte boundary.
+ *  @param data A pointer to the data to program.
+ *  @param size The number of bytes to program, which must be a multiple of 16.
+ *  @return bool - TRUE if the block was programmed successfully.
+ *  @note Assumes Flash has been initialized and the block has been erased.
+ */
+bool Flash_WriteSection(const uint32_t address, const void* const data, const uint32_t size);
+
+/*! @brief Runs a Swap Control command, which exchanges the addresses of program flash blocks 0 and 1 at reset.
+ *
+ *  The indicator is in block 0, so interrupts are masked until the command completes.
+ *  @param indicatorAddress The address of the swap indicator, in a sector of block 0 that the firmware does not use.
+ *  @param control The command code.
+ *  @param mode The address of a variable to store the swap state after the command, or NULL.
+ *  @return bool - TRUE if the command completed without an error.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_SwapControl(const uint32_t indicatorAddress, const TFlashSwapControl control, TFlashSwapMode* const mode);
+
+/*! @brief Starts programming one phrase of Flash.
+ *
+ *  @param address The address of the phrase, which must be aligned to an 8-byte boundary.
+ *  @param phrase The 64-bit data to program, with the byte at address in the least significant byte.
+ *  @param userFunction is a pointer to a user callback function called from the interrupt on completion, or NULL.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the command was launched, FALSE if the address is misaligned or in block 0, or Flash is busy.
+ *  @note Assumes Flash has been initialized and the phrase has been erased.
+ */
+bool Flash_ProgramPhraseAsync(const uint32_t address, const uint64_t phrase, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Starts erasing one Flash sector.
+ *
+ *  @param address Any address in the sector to erase.
+ *  @param userFunction is a pointer to a user callback function called from the interrupt on completion, or NULL.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the command was launched, FALSE if the address is in block 0 or Flash is busy.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_EraseSectorAsync(const uint32_t address, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Starts programming all changes in the RAM shadow to Flash.
+ *
+ *  Works like Flash_Commit, with the erases and each phrase program command chained from the interrupt.
+ *  Writes made during the commit stay dirty for the next commit unless their phrase had not yet been programmed.
+ *  @param userFunction is a pointer to a user callback function called when the commit ends, or NULL.
+ *         It may be called before Flash_CommitAsync returns if no erase is needed.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the commit was started, FALSE if Flash is busy.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Flash_CommitAsync(void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Checks whether an asynchronous operation is in progress.
+ *
+ *  @return bool - TRUE if Flash is busy.
+ */
+bool Flash_IsBusy(void);
+
+/*! @brief Gets the result of the last asynchronous operation.
+ *
+ *  @return bool - TRUE if the last asynchronous operation completed without an error.
+ */
+bool Flash_AsyncSucceeded(void);
+
+#ifdef FLASH_BENCHMARK
+
+// Sector erased and programmed by Flash_Benchmark, between the data region and the key-value store
+#ifndef FLASH_BENCHMARK_ADDRESS
+#define FLASH_BENCHMARK_ADDRESS 0x000F7000LU
+#endif
+
+/*!
+ * @struct TFlashBenchmarkResult
+ */
+typedef struct
+{
+  uint32_t phraseCycles;   /*!< Core clock cycles to program a sector with one Program Phrase command per phrase */
+  uint32_t sectionCycles;  /*!< Core clock cycles to program a sector with Flash_WriteSection */
+} TFlashBenchmarkResult;
+
+/*! @brief Measures programming a sector one phrase at a time and with Program Section commands.
+ *
+ *  The sector at FLASH_BENCHMARK_ADDRESS is erased before each run, and checked after it.
+ *  Each result is the best of several runs, and the erases are not timed.
+ *  The results are also written to ITM stimulus port 0 (SWO), with the throughput in bytes per second.
+ *  @param result The address to store the result, or NULL.
+ *  @return bool - TRUE if every command succeeded and the sector read back correctly.
+ *  @note Assumes Flash has been initialized. The sector is left erased.
+ */
+bool Flash_Benchmark(TFlashBenchmarkResult* const result);
+
+#endif
+
+// The interrupt handler is a plain function called by the simulator in host builds
+#ifdef FLASH_SIM
+#define FLASH_ISR
+#else
+#define FLASH_ISR __attribute__ ((interrupt))
+#endif
+
+/*! @brief Interrupt service routine for the Flash command complete interrupt.
+ *
+ *  Chains the next command of an asynchronous commit, or calls the user callback.
+ *  @note Assumes Flash has been initialized.
+ */
+void FLASH_ISR FTFE_IRQHandler(void);
+
 #endif
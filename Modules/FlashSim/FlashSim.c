@@ -0,0 +1,339 @@
+/*! @file
+ *
+ *  @brief Host simulation of the FTFE Flash controller.
+ *
+ *  Each command runs on the image as soon as it is launched.
+ *  Programming ANDs the new data into the image and fails verification (MGSTAT0) if a bit would need to go from 0 to 1,
+ *  as the real Flash does.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+// The simulator is only part of host builds
+#ifdef FLASH_SIM
+
+#include <assert.h>
+#include <string.h>
+
+#include "Flash\Flash.h"
+#include "FlashSim\FlashSim.h"
+#include "FlashSim\FlashSimRegs.h"
+
+// FTFE commands
+#define FLASH_CMD_PGM8   0x07
+#define FLASH_CMD_ERSSCR 0x09
+#define FLASH_CMD_PGMSEC 0x0B
+
+#define FLASH_SIM_NB_SECTORS (FLASH_SIM_SIZE / FLASH_SECTOR_SIZE)
+#define FLASH_SIM_NB_PHRASES (FLASH_SIM_SIZE / FLASH_PHRASE_SIZE)
+
+FTFE_Type FlashSim_FTFE;
+
+// Program Flash
+static union
+{
+  uint64_t phrases[FLASH_SIM_NB_PHRASES];
+  uint8_t bytes[FLASH_SIM_SIZE];
+} Image;
+
+// FlexRAM, used as RAM for Program Section
+static union
+{
+  uint32_t words[FLASH_FLEXRAM_SIZE / 4];
+  uint8_t bytes[FLASH_FLEXRAM_SIZE];
+} FlexRAM;
+
+// Bitmap of phrases programmed since their sector was erased
+static uint32_t Programmed[FLASH_SIM_NB_PHRASES / 32];
+
+static uint32_t EraseCounts[FLASH_SIM_NB_SECTORS];
+static TFlashSimStats Stats;
+
+// Simulated clock, and the completion time of a command in progress
+static uint64_t Time;
+static uint64_t DoneTime;
+static bool Pending;
+
+// Power loss - the command after the budget is torn, and those after it do nothing
+static bool PowerFailing;
+static uint32_t PowerBudget;
+static bool Torn;
+static bool PowerLost;
+
+/*! @brief Programs one phrase of the image.
+ *
+ *  @param phrase The phrase number.
+ *  @param data The bytes to program, lowest address first.
+ *  @return bool - TRUE if the phrase verifies.
+ */
+static bool ProgramPhrase(const uint32_t phrase, const uint8_t data[FLASH_PHRASE_SIZE])
+{
+  uint8_t* bytes = &Image.bytes[phrase * FLASH_PHRASE_SIZE];
+  uint8_t nbBytes = Torn ? FLASH_PHRASE_SIZE / 2 : FLASH_PHRASE_SIZE;
+  bool verified = true;
+
+  if (Programmed[phrase / 32] & (1LU << (phrase % 32)))
+    Stats.nbOverPrograms++;
+  Programmed[phrase / 32] |= 1LU << (phrase % 32);
+  Stats.nbPhrases++;
+
+  // Programming can only clear bits
+  for (uint8_t i = 0; i < nbBytes; i++)
+  {
+    bytes[i] &= data[i];
+    if (bytes[i] != data[i])
+      verified = false;
+  }
+
+  return verified;
+}
+
+/*! @brief Runs a Program Phrase command.
+ *
+ *  @param address The Flash address from FCCOB1 to FCCOB3.
+ *  @param duration Set to the command time in microseconds.
+ *  @return uint8_t - the FSTAT error flags.
+ */
+static uint8_t CommandPGM8(const uint32_t address, uint32_t* const duration)
+{
+  uint8_t data[FLASH_PHRASE_SIZE];
+
+  if ((address & (FLASH_PHRASE_SIZE - 1)) || (address >= FLASH_SIM_SIZE))
+    return FTFE_FSTAT_ACCERR_MASK;
+
+  // Each word is loaded most significant byte first
+  data[0] = FTFE->FCCOB7;
+  data[1] = FTFE->FCCOB6;
+  data[2] = FTFE->FCCOB5;
+  data[3] = FTFE->FCCOB4;
+  data[4] = FTFE->FCCOBB;
+  data[5] = FTFE->FCCOBA;
+  data[6] = FTFE->FCCOB9;
+  data[7] = FTFE->FCCOB8;
+
+  *duration = FLASH_SIM_PGM8_US;
+  return ProgramPhrase(address / FLASH_PHRASE_SIZE, data) ? 0 : FTFE_FSTAT_MGSTAT0_MASK;
+}
+
+/*! @brief Runs an Erase Flash Sector command.
+ *
+ *  @param address The Flash address from FCCOB1 to FCCOB3.
+ *  @param duration Set to the command time in microseconds.
+ *  @return uint8_t - the FSTAT error flags.
+ */
+static uint8_t CommandERSSCR(const uint32_t address, uint32_t* const duration)
+{
+  uint32_t sector = address / FLASH_SECTOR_SIZE;
+  uint32_t firstPhrase = sector * (FLASH_SECTOR_SIZE / FLASH_PHRASE_SIZE);
+
+  if ((address & (FLASH_SECTION_ALIGNMENT - 1)) || (address >= FLASH_SIM_SIZE))
+    return FTFE_FSTAT_ACCERR_MASK;
+
+  memset(&Image.bytes[sector * FLASH_SECTOR_SIZE], 0xFF, Torn ? FLASH_SECTOR_SIZE / 2 : FLASH_SECTOR_SIZE);
+  memset(&Programmed[firstPhrase / 32], 0, FLASH_SECTOR_SIZE / FLASH_PHRASE_SIZE / 8);
+  EraseCounts[sector]++;
+  Stats.nbErases++;
+
+  *duration = FLASH_SIM_ERSSCR_US;
+
+  // A worn out sector no longer erases reliably
+  if (EraseCounts[sector] > FLASH_SIM_ENDURANCE)
+  {
+    Image.bytes[sector * FLASH_SECTOR_SIZE] = 0x00;
+    return FTFE_FSTAT_MGSTAT0_MASK;
+  }
+
+  return 0;
+}
+
+/*! @brief Runs a Program Section command from the FlexRAM.
+ *
+ *  @param address The Flash address from FCCOB1 to FCCOB3.
+ *  @param duration Set to the command time in microseconds.
+ *  @return uint8_t - the FSTAT error flags.
+ */
+static uint8_t CommandPGMSEC(const uint32_t address, uint32_t* const duration)
+{
+  uint32_t size = (((uint32_t)FTFE->FCCOB4 << 8) | FTFE->FCCOB5) * FLASH_SECTION_ALIGNMENT;
+  uint8_t errors = 0;
+
+  if ((address & (FLASH_SECTION_ALIGNMENT - 1)) || (size == 0) || (size > FLASH_FLEXRAM_SIZE)
+      || (address + size > FLASH_SIM_SIZE) || !(FTFE->FCNFG & FTFE_FCNFG_RAMRDY_MASK))
+    return FTFE_FSTAT_ACCERR_MASK;
+
+  for (uint32_t offset = 0; offset < size; offset += FLASH_PHRASE_SIZE)
+  {
+    if (!ProgramPhrase((address + offset) / FLASH_PHRASE_SIZE, &FlexRAM.bytes[offset]))
+      errors = FTFE_FSTAT_MGSTAT0_MASK;
+  }
+
+  *duration = (uint32_t)(((uint64_t)FLASH_SIM_PGMSEC_1K_US * size + 1023) / 1024);
+  return errors;
+}
+
+void FlashSim_Init(void)
+{
+  memset(Image.bytes, 0xFF, sizeof(Image.bytes));
+  memset(FlexRAM.bytes, 0xFF, sizeof(FlexRAM.bytes));
+  memset(Programmed, 0, sizeof(Programmed));
+  memset(EraseCounts, 0, sizeof(EraseCounts));
+  memset(&Stats, 0, sizeof(Stats));
+  memset(&FlashSim_FTFE, 0, sizeof(FlashSim_FTFE));
+
+  // Idle, with the FlexRAM available as RAM
+  FTFE->FSTAT = FTFE_FSTAT_CCIF_MASK;
+  FTFE->FCNFG = FTFE_FCNFG_RAMRDY_MASK;
+
+  Time = 0;
+  Pending = false;
+  FlashSim_PowerOn();
+}
+
+uint8_t* FlashSim_Address(const uint32_t address)
+{
+  if (address < FLASH_SIM_SIZE)
+    return &Image.bytes[address];
+
+  assert((address >= FLASH_FLEXRAM_START) && (address < FLASH_FLEXRAM_START + FLASH_FLEXRAM_SIZE));
+  return &FlexRAM.bytes[address - FLASH_FLEXRAM_START];
+}
+
+void FlashSim_Launch(const bool wait)
+{
+  uint32_t address = ((uint32_t)FTFE->FCCOB1 << 16) | ((uint32_t)FTFE->FCCOB2 << 8) | FTFE->FCCOB3;
+  uint32_t duration = 0;
+  uint8_t errors;
+
+  assert(!Pending);
+  Stats.nbCommands++;
+
+  if (PowerFailing && !PowerLost && (PowerBudget-- == 0))
+  {
+    PowerLost = true;
+    Torn = true;
+  }
+
+  if (PowerLost && !Torn)
+    errors = FTFE_FSTAT_MGSTAT0_MASK;
+  else
+  {
+    switch (FTFE->FCCOB0)
+    {
+      case FLASH_CMD_PGM8:
+        errors = CommandPGM8(address, &duration);
+        break;
+      case FLASH_CMD_ERSSCR:
+        errors = CommandERSSCR(address, &duration);
+        break;
+      case FLASH_CMD_PGMSEC:
+        errors = CommandPGMSEC(address, &duration);
+        break;
+      default:
+        errors = FTFE_FSTAT_ACCERR_MASK;
+        break;
+    }
+  }
+
+  // A torn command never reports success
+  if (Torn)
+  {
+    Torn = false;
+    errors |= FTFE_FSTAT_MGSTAT0_MASK;
+  }
+
+  if (errors)
+    Stats.nbErrors++;
+  Stats.busyTime += duration;
+
+  // The write of CCIF that launched the command also cleared the old flags
+  FTFE->FSTAT = errors;
+
+  if (wait)
+  {
+    Time += duration;
+    FTFE->FSTAT |= FTFE_FSTAT_CCIF_MASK;
+  }
+  else
+  {
+    DoneTime = Time + duration;
+    Pending = true;
+  }
+}
+
+void FlashSim_Advance(const uint32_t microseconds)
+{
+  uint64_t end = Time + microseconds;
+
+  // The interrupt may launch the next command, which can also complete in this interval
+  while (Pending && (DoneTime <= end))
+  {
+    Time = DoneTime;
+    Pending = false;
+    FTFE->FSTAT |= FTFE_FSTAT_CCIF_MASK;
+
+    if (FTFE->FCNFG & FTFE_FCNFG_CCIE_MASK)
+      FTFE_IRQHandler();
+  }
+
+  if (Time < end)
+    Time = end;
+}
+
+void FlashSim_Idle(void)
+{
+  while (Pending)
+    FlashSim_Advance((uint32_t)(DoneTime - Time));
+}
+
+uint64_t FlashSim_Time(void)
+{
+  return Time;
+}
+
+uint32_t FlashSim_EraseCount(const uint32_t address)
+{
+  assert(address < FLASH_SIM_SIZE);
+  return EraseCounts[address / FLASH_SECTOR_SIZE];
+}
+
+uint32_t FlashSim_MaxEraseCount(void)
+{
+  uint32_t max = 0;
+
+  for (uint32_t sector = 0; sector < FLASH_SIM_NB_SECTORS; sector++)
+  {
+    if (EraseCounts[sector] > max)
+      max = EraseCounts[sector];
+  }
+
+  return max;
+}
+
+void FlashSim_PowerFail(const uint32_t nbCommands)
+{
+  PowerFailing = true;
+  PowerBudget = nbCommands;
+}
+
+void FlashSim_PowerOn(void)
+{
+  PowerFailing = false;
+  PowerLost = false;
+  Torn = false;
+}
+
+void FlashSim_SetFlexRAM(const bool available)
+{
+  if (available)
+    FTFE->FCNFG |= FTFE_FCNFG_RAMRDY_MASK;
+  else
+    FTFE->FCNFG &= ~FTFE_FCNFG_RAMRDY_MASK;
+}
+
+void FlashSim_GetStats(TFlashSimStats* const stats)
+{
+  *stats = Stats;
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*! @file
+ *
+ *  @brief Host simulation of the FTFE Flash controller.
+ *
+ *  This contains a RAM image of the program Flash and FlexRAM, and an FTFE register block that runs
+ *  Program Phrase, Erase Flash Sector and Program Section commands on the image.
+ *  Commands take simulated time from the typical K64 data sheet figures, programming can only clear bits,
+ *  and each sector keeps an erase count, so Flash, KVStore and update code can be benchmarked and
+ *  endurance-tested on a PC. Power can be cut after any command to test recovery from a reset.
+ *  Build Flash.c, FlashSim.c and the code under test with FLASH_SIM defined and a host compiler.
+ *  The Flash.h access macros then read the image, and FlashSimRegs.h stands in for MK64F12.h in Flash.c.
+ *  The host programs in test/ use the simulator to check and benchmark the Flash and KVStore modules.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef FLASHSIM_H
+#define FLASHSIM_H
+
+// new types
+#include "Types\types.h"
+
+// Size of the simulated program Flash
+#define FLASH_SIM_SIZE 0x00100000LU
+
+// Typical command times in microseconds, from the K64 data sheet
+#ifndef FLASH_SIM_ERSSCR_US
+#define FLASH_SIM_ERSSCR_US    13000
+#endif
+#ifndef FLASH_SIM_PGM8_US
+#define FLASH_SIM_PGM8_US      50
+#endif
+#ifndef FLASH_SIM_PGMSEC_1K_US
+#define FLASH_SIM_PGMSEC_1K_US 5000
+#endif
+
+// Guaranteed number of erase cycles per sector - erases beyond this fail verification
+#ifndef FLASH_SIM_ENDURANCE
+#define FLASH_SIM_ENDURANCE 10000
+#endif
+
+/*!
+ * @struct TFlashSimStats
+ */
+typedef struct
+{
+  uint32_t nbCommands;       /*!< Commands launched */
+  uint32_t nbErrors;         /*!< Commands that ended with ACCERR or MGSTAT0 */
+  uint32_t nbErases;         /*!< Sector erases */
+  uint32_t nbPhrases;        /*!< Phrases programmed by any command */
+  uint32_t nbOverPrograms;   /*!< Phrases programmed more than once between erases */
+  uint64_t busyTime;         /*!< Total command time in microseconds */
+} TFlashSimStats;
+
+/*! @brief Sets up the simulator with the whole Flash erased and all erase counts at 0.
+ */
+void FlashSim_Init(void);
+
+/*! @brief Gets the image address of a Flash or FlexRAM address.
+ *
+ *  @param address An address in the program Flash or the FlexRAM.
+ *  @return uint8_t* - the address in the image.
+ *  @note Aborts if the address is outside the simulated memory.
+ */
+uint8_t* FlashSim_Address(const uint32_t address);
+
+/*! @brief Advances the simulated clock, completing any command in progress.
+ *
+ *  Host code calls this instead of waiting for an asynchronous operation, which would never end.
+ *  @param microseconds The time to advance.
+ */
+void FlashSim_Advance(const uint32_t microseconds);
+
+/*! @brief Advances the simulated clock until no command is in progress.
+ */
+void FlashSim_Idle(void);
+
+/*! @brief Gets the simulated clock.
+ *
+ *  @return uint64_t - the time since FlashSim_Init in microseconds.
+ */
+uint64_t FlashSim_Time(void);
+
+/*! @brief Gets the number of times a sector has been erased.
+ *
+ *  @param address Any address in the sector.
+ *  @return uint32_t - the erase count.
+ */
+uint32_t FlashSim_EraseCount(const uint32_t address);
+
+/*! @brief Gets the highest erase count of any sector.
+ *
+ *  @return uint32_t - the erase count of the most worn sector.
+ */
+uint32_t FlashSim_MaxEraseCount(void);
+
+/*! @brief Simulates losing power after a number of further commands.
+ *
+ *  The command running when power is lost is left half done: a program command sets only the first half of each phrase,
+ *  and an erase only erases the first half of the sector. Later commands leave the image unchanged and fail,
+ *  so the code under test can be stopped part way through an operation and then restarted as after a reset.
+ *  @param nbCommands The number of commands that still complete.
+ */
+void FlashSim_PowerFail(const uint32_t nbCommands);
+
+/*! @brief Restores power after FlashSim_PowerFail.
+ *
+ *  The image keeps whatever was programmed before power was lost.
+ */
+void FlashSim_PowerOn(void);
+
+/*! @brief Makes the FlexRAM available as RAM, or not, as when it has been partitioned for EEPROM.
+ *
+ *  Program Section commands fail with ACCERR while the FlexRAM is not available.
+ *  @param available TRUE to set RAMRDY, FALSE to clear it.
+ */
+void FlashSim_SetFlexRAM(const bool available);
+
+/*! @brief Gets the command statistics since FlashSim_Init.
+ *
+ *  @param stats A pointer to the statistics to fill in.
+ */
+void FlashSim_GetStats(TFlashSimStats* const stats);
+
+#endif
@@ -0,0 +1,85 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the parts of MK64F12.h used by the Flash module.
+ *
+ *  This contains the simulated FTFE register block, and the core functions and critical sections that Flash.c uses.
+ *  Only Flash.c and FlashSim.c include it, in host builds with FLASH_SIM defined,
+ *  so the names it defines do not leak into the code under test.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef FLASHSIMREGS_H
+#define FLASHSIMREGS_H
+
+// new types
+#include "Types\types.h"
+
+/*!
+ * @struct FTFE_Type
+ *  Same layout as the FTFE register block in MK64F12.h.
+ */
+typedef struct
+{
+  volatile uint8_t FSTAT;
+  volatile uint8_t FCNFG;
+  volatile uint8_t FSEC;
+  volatile uint8_t FOPT;
+  volatile uint8_t FCCOB3;
+  volatile uint8_t FCCOB2;
+  volatile uint8_t FCCOB1;
+  volatile uint8_t FCCOB0;
+  volatile uint8_t FCCOB7;
+  volatile uint8_t FCCOB6;
+  volatile uint8_t FCCOB5;
+  volatile uint8_t FCCOB4;
+  volatile uint8_t FCCOBB;
+  volatile uint8_t FCCOBA;
+  volatile uint8_t FCCOB9;
+  volatile uint8_t FCCOB8;
+  volatile uint8_t FPROT3;
+  volatile uint8_t FPROT2;
+  volatile uint8_t FPROT1;
+  volatile uint8_t FPROT0;
+  uint8_t RESERVED_0[2];
+  volatile uint8_t FEPROT;
+  volatile uint8_t FDPROT;
+} FTFE_Type;
+
+extern FTFE_Type FlashSim_FTFE;
+
+#define FTFE (&FlashSim_FTFE)
+
+// Register masks used by the Flash module
+#define FTFE_FSTAT_MGSTAT0_MASK  0x01U
+#define FTFE_FSTAT_FPVIOL_MASK   0x10U
+#define FTFE_FSTAT_ACCERR_MASK   0x20U
+#define FTFE_FSTAT_RDCOLERR_MASK 0x40U
+#define FTFE_FSTAT_CCIF_MASK     0x80U
+#define FTFE_FCNFG_RAMRDY_MASK   0x02U
+#define FTFE_FCNFG_CCIE_MASK     0x80U
+
+// Core functions used by the Flash module
+#define FTFE_IRQn 18
+#define NVIC_ClearPendingIRQ(irq)       ((void)(irq))
+#define NVIC_EnableIRQ(irq)             ((void)(irq))
+#define NVIC_SetPriority(irq, priority) ((void)(irq))
+#define __CLZ(value)                    ((uint32_t)__builtin_clz(value))
+
+// Host code is never in an interrupt handler, and the simulator calls FTFE_IRQHandler from FlashSim_Advance,
+// so there is nothing for a critical section to mask
+#define __get_IPSR()   0u
+#define EnterCritical() do {} while (0)
+#define ExitCritical()  do {} while (0)
+
+/*! @brief Runs the command loaded in the FCCOB registers.
+ *
+ *  Called by the Flash module after it writes CCIF.
+ *  The image is updated at once. A blocking command adds its time to the simulated clock and sets CCIF;
+ *  otherwise CCIF is set, and the interrupt called, when FlashSim_Advance passes the completion time.
+ *  @param wait TRUE if the caller waits for CCIF.
+ */
+void FlashSim_Launch(const bool wait);
+
+#endif
@@ -0,0 +1,639 @@
+/*! @file
+ *
+ *  @brief Routines for a wear-levelled key-value store in Flash.
+ *
+ *  Each sector starts with a header phrase holding a magic number and a sequence number,
+ *  and sectors are used in ring order, so the valid sector with the highest sequence number is the newest.
+ *  Records are phrase-aligned: a 3-byte record header (key and length) is followed immediately by the value,
+ *  padded with 0xFF to a whole number of phrases, and a CRC in the last byte.
+ *  The phrases are programmed in order and the CRC is never stored as 0xFF, so a record torn by a reset before its last phrase
+ *  always fails its check. It is skipped using the length from its header.
+ *  A transaction is staged in RAM and written as contiguous records in one sector, flagged in their length field,
+ *  followed by a commit marker holding the number of records. The boot scan holds the flagged records back
+ *  and only indexes the ones covered by a commit marker, so a reset mid-commit leaves the previous values.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "KVStore\KVStore.h"
+#include "Flash\Flash.h"
+
+// Identifies a sector that belongs to the store
+#define KVSTORE_MAGIC 0x3253564BLU  // "KVS2"
+
+// Record length marking a deleted key
+#define KVSTORE_TOMBSTONE 0xFEu
+// Record length flag marking a value written by a transaction
+#define KVSTORE_TXN_FLAG 0x80u
+// Record length marking a key deleted by a transaction
+#define KVSTORE_TXN_TOMBSTONE 0xFDu
+
+// Size of a record header in bytes - the value follows it
+#define KVSTORE_HEADER_SIZE 3
+// Size of the CRC at the end of a record in bytes
+#define KVSTORE_CRC_SIZE 1
+
+// Largest record in bytes
+#define KVSTORE_RECORD_MAX_SIZE (((KVSTORE_HEADER_SIZE + KVSTORE_MAX_VALUE_SIZE + KVSTORE_CRC_SIZE + FLASH_PHRASE_SIZE - 1) / FLASH_PHRASE_SIZE) * FLASH_PHRASE_SIZE)
+
+// Garbage collection copies at most every live record into a freshly opened sector,
+// which must still leave room for a whole transaction and its commit marker
+#if (KVSTORE_MAX_KEYS + KVSTORE_MAX_TXN_RECORDS + 1) * KVSTORE_RECORD_MAX_SIZE > FLASH_SECTOR_SIZE - FLASH_PHRASE_SIZE
+#error "KVSTORE_MAX_KEYS records of KVSTORE_MAX_VALUE_SIZE bytes do not fit in a sector"
+#endif
+
+#if KVSTORE_NB_SECTORS < 2
+#error "KVSTORE_NB_SECTORS must be at least 2 to leave a spare sector"
+#endif
+
+#if (KVSTORE_TXN_FLAG | KVSTORE_MAX_VALUE_SIZE) >= KVSTORE_TXN_TOMBSTONE
+#error "KVSTORE_MAX_VALUE_SIZE is too large to flag transaction records"
+#endif
+
+#define ERASED_WORD 0xFFFFFFFFLU
+
+/*!
+ * @struct TKVIndexEntry
+ */
+typedef struct
+{
+  uint16_t key;      /*!< The key */
+  uint32_t address;  /*!< The Flash address of the newest record for the key */
+} TKVIndexEntry;
+
+static TKVIndexEntry Index[KVSTORE_MAX_KEYS];
+static uint8_t NbKeys;
+
+static uint8_t Head;            // Index of the newest sector
+static uint32_t Sequence;       // Sequence number of the newest sector
+static uint32_t WriteAddress;   // Next free phrase in the newest sector
+
+/*!
+ * @struct TKVStaged
+ */
+typedef struct
+{
+  uint16_t key;                            /*!< The key */
+  uint8_t length;                          /*!< The value length, or KVSTORE_TOMBSTONE */
+  uint8_t value[KVSTORE_MAX_VALUE_SIZE];   /*!< The value */
+} TKVStaged;
+
+// The open transaction
+static bool InTransaction;
+static TKVStaged Staged[KVSTORE_MAX_TXN_RECORDS];
+static uint8_t NbStaged;
+
+// Addresses of the newest transaction records found by the boot scan that are not yet committed
+static uint32_t Pending[KVSTORE_MAX_TXN_RECORDS];
+static uint32_t NbPending;
+
+/*! @brief Gets the address of a sector.
+ */
+static uint32_t SectorAddress(const uint8_t sector)
+{
+  return KVSTORE_START + (uint32_t)sector * FLASH_SECTOR_SIZE;
+}
+
+/*! @brief Checks whether a sector has a valid header.
+ */
+static bool SectorValid(const uint8_t sector)
+{
+  return _FW(SectorAddress(sector)) == KVSTORE_MAGIC;
+}
+
+/*! @brief Checks whether a sector is completely erased.
+ */
+static bool SectorErased(const uint8_t sector)
+{
+  for (uint32_t address = SectorAddress(sector); address < SectorAddress(sector) + FLASH_SECTOR_SIZE; address += 4)
+  {
+    if (_FW(address) != ERASED_WORD)
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Calculates the CRC-8 (polynomial 0x07) of a record.
+ *
+ *  0xFF is stored as 0x00, so an erased CRC byte always marks a record whose last phrase was never programmed.
+ *  @param key The key.
+ *  @param length The record length field.
+ *  @param value The address of the value (in RAM or Flash).
+ *  @param valueLength The number of value bytes.
+ */
+static uint8_t RecordCRC(const uint16_t key, const uint8_t length, const volatile uint8_t* const value, const uint8_t valueLength)
+{
+  uint8_t crc = 0xFF;
+  uint8_t byte;
+
+  for (uint16_t i = 0; i < 3u + valueLength; i++)
+  {
+    if (i == 0)
+      byte = (uint8_t)key;
+    else if (i == 1)
+      byte = (uint8_t)(key >> 8);
+    else if (i == 2)
+      byte = length;
+    else
+      byte = value[i - 3];
+
+    crc ^= byte;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80u) ? (uint8_t)((crc << 1) ^ 0x07u) : (uint8_t)(crc << 1);
+  }
+
+  return (crc == 0xFFu) ? 0x00u : crc;
+}
+
+/*! @brief Checks whether a record length field marks a transaction record.
+ */
+static bool Transactional(const uint8_t length)
+{
+  return (length == KVSTORE_TXN_TOMBSTONE)
+      || ((length & KVSTORE_TXN_FLAG) && ((length & ~KVSTORE_TXN_FLAG) <= KVSTORE_MAX_VALUE_SIZE));
+}
+
+/*! @brief Gets a record length field without the transaction flag.
+ *
+ *  @return uint8_t - the value length, KVSTORE_TOMBSTONE, or an invalid length.
+ */
+static uint8_t PlainLength(const uint8_t length)
+{
+  if (length == KVSTORE_TXN_TOMBSTONE)
+    return KVSTORE_TOMBSTONE;
+
+  if (Transactional(length))
+    return (uint8_t)(length & ~KVSTORE_TXN_FLAG);
+
+  return length;
+}
+
+/*! @brief Gets the number of value bytes in a record.
+ */
+static uint8_t ValueLength(const uint8_t length)
+{
+  uint8_t plain = PlainLength(length);
+
+  return (plain == KVSTORE_TOMBSTONE) ? 0 : plain;
+}
+
+/*! @brief Gets the size of a record in bytes, rounded up to whole phrases.
+ */
+static uint32_t RecordSize(const uint8_t length)
+{
+  return ((KVSTORE_HEADER_SIZE + ValueLength(length) + KVSTORE_CRC_SIZE + FLASH_PHRASE_SIZE - 1) / FLASH_PHRASE_SIZE) * FLASH_PHRASE_SIZE;
+}
+
+/*! @brief Finds the index entry for a key.
+ *
+ *  @return TKVIndexEntry* - the entry, or NULL if the key is not stored.
+ */
+static TKVIndexEntry* IndexFind(const uint16_t key)
+{
+  for (uint8_t i = 0; i < NbKeys; i++)
+  {
+    if (Index[i].key == key)
+      return &Index[i];
+  }
+
+  return NULL;
+}
+
+/*! @brief Points the index entry for a key at a record, or removes it for a tombstone.
+ *
+ *  @return bool - FALSE if the index is full.
+ */
+static bool IndexUpdate(const uint16_t key, const uint8_t length, const uint32_t address)
+{
+  TKVIndexEntry* entry = IndexFind(key);
+
+  if (length == KVSTORE_TOMBSTONE)
+  {
+    if (entry)
+      *entry = Index[--NbKeys];
+    return true;
+  }
+
+  if (!entry)
+  {
+    if (NbKeys >= KVSTORE_MAX_KEYS)
+      return false;
+    entry = &Index[NbKeys++];
+    entry->key = key;
+  }
+
+  entry->address = address;
+  return true;
+}
+
+/*! @brief Programs a record at WriteAddress.
+ *
+ *  @param length The record length field, which may carry the transaction flag.
+ *  @param value The address of the value (in RAM or Flash).
+ *  @return bool - TRUE if the record was programmed, FALSE if it does not fit in the newest sector or programming failed.
+ */
+static bool ProgramRecord(const uint16_t key, const uint8_t length, const volatile uint8_t* const value)
+{
+  uint8_t phrase[FLASH_PHRASE_SIZE];
+  uint8_t valueLength = ValueLength(length);
+  uint32_t address = WriteAddress;
+  uint32_t size = RecordSize(length);
+  uint64_t data;
+  uint16_t i;
+
+  if (WriteAddress + size > SectorAddress(Head) + FLASH_SECTOR_SIZE)
+    return false;
+
+  // Record header and value are contiguous, so the first phrase carries the first 5 value bytes
+  for (i = 0; i < size; i++)
+  {
+    if (i == 0)
+      phrase[0] = (uint8_t)key;
+    else if (i == 1)
+      phrase[1] = (uint8_t)(key >> 8);
+    else if (i == 2)
+      phrase[2] = length;
+    else if (i == size - KVSTORE_CRC_SIZE)
+      phrase[i % FLASH_PHRASE_SIZE] = RecordCRC(key, length, value, valueLength);
+    else if (i - KVSTORE_HEADER_SIZE < valueLength)
+      phrase[i % FLASH_PHRASE_SIZE] = value[i - KVSTORE_HEADER_SIZE];
+    else
+      phrase[i % FLASH_PHRASE_SIZE] = 0xFF;
+
+    if (i % FLASH_PHRASE_SIZE == FLASH_PHRASE_SIZE - 1)
+    {
+      data = 0;
+      for (uint8_t byte = FLASH_PHRASE_SIZE; byte > 0; byte--)
+        data = (data << 8) | phrase[byte - 1];
+
+      // Claim the space even if programming fails, since the phrase may be partly programmed
+      WriteAddress += FLASH_PHRASE_SIZE;
+      if (!Flash_ProgramPhrase(address + i + 1 - FLASH_PHRASE_SIZE, data))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/*! @brief Programs a record at WriteAddress and points the index at it.
+ *
+ *  @param value The address of the value (in RAM or Flash).
+ *  @return bool - TRUE if the record was programmed and indexed.
+ */
+static bool WriteRecord(const uint16_t key, const uint8_t length, const volatile uint8_t* const value)
+{
+  uint32_t address = WriteAddress;
+
+  return ProgramRecord(key, length, value) && IndexUpdate(key, length, address);
+}
+
+/*! @brief Copies the live records out of a sector and erases it.
+ *
+ *  @return bool - TRUE if the sector was collected successfully.
+ */
+static bool Collect(const uint8_t sector)
+{
+  uint32_t start = SectorAddress(sector);
+
+  for (uint8_t i = 0; i < NbKeys; i++)
+  {
+    uint32_t address = Index[i].address;
+
+    if ((address >= start) && (address < start + FLASH_SECTOR_SIZE))
+    {
+      // Copies update the entry in place, so the index order is unchanged
+      if (!WriteRecord(Index[i].key, PlainLength(_FB(address + 2)), &_FB(address + KVSTORE_HEADER_SIZE)))
+        return false;
+    }
+  }
+
+  return Flash_EraseSector(start);
+}
+
+/*! @brief Opens the next sector in the ring and frees the one after it.
+ *
+ *  @return bool - TRUE if a new sector was opened successfully.
+ */
+static bool OpenNextSector(void)
+{
+  uint8_t next = (uint8_t)((Head + 1) % KVSTORE_NB_SECTORS);
+
+  if (!SectorErased(next) && !Flash_EraseSector(SectorAddress(next)))
+    return false;
+
+  if (!Flash_ProgramPhrase(SectorAddress(next), ((uint64_t)(Sequence + 1) << 32) | KVSTORE_MAGIC))
+    return false;
+
+  Head = next;
+  Sequence++;
+  WriteAddress = SectorAddress(Head) + FLASH_PHRASE_SIZE;
+
+  // Keep the sector after the newest one erased as the spare
+  next = (uint8_t)((Head + 1) % KVSTORE_NB_SECTORS);
+  if (SectorValid(next))
+    return Collect(next);
+
+  return true;
+}
+
+/*! @brief Indexes the newest transaction records found by the scan, as covered by a commit marker.
+ *
+ *  Records left by an earlier commit that was interrupted are older than the committed ones, so they are skipped.
+ *  @param count The number of records in the committed transaction.
+ */
+static void ScanCommit(const uint8_t count)
+{
+  uint32_t address;
+
+  if ((count <= KVSTORE_MAX_TXN_RECORDS) && (count <= NbPending))
+  {
+    for (uint8_t i = count; i > 0; i--)
+    {
+      address = Pending[(NbPending - i) % KVSTORE_MAX_TXN_RECORDS];
+      (void)IndexUpdate(_FH(address), PlainLength(_FB(address + 2)), address);
+    }
+  }
+
+  NbPending = 0;
+}
+
+/*! @brief Adds the records in a sector to the index.
+ *
+ *  Each record is read once, so the boot cost is bounded by the size of the store.
+ *  For the newest sector, also finds the first free phrase.
+ */
+static void ScanSector(const uint8_t sector)
+{
+  uint32_t end = SectorAddress(sector) + FLASH_SECTOR_SIZE;
+  uint32_t address = SectorAddress(sector) + FLASH_PHRASE_SIZE;
+  uint16_t key;
+  uint8_t length;
+
+  // Transactions never span sectors
+  NbPending = 0;
+
+  while (address < end)
+  {
+    if ((_FW(address) == ERASED_WORD) && (_FW(address + 4) == ERASED_WORD))
+      break;
+
+    key = _FH(address);
+    length = _FB(address + 2);
+
+    // A header torn by a reset - nothing after it can be trusted
+    if ((PlainLength(length) > KVSTORE_MAX_VALUE_SIZE) && (PlainLength(length) != KVSTORE_TOMBSTONE))
+    {
+      address = end;
+      break;
+    }
+
+    if ((key != KVSTORE_KEY_INVALID) && (address + RecordSize(length) <= end)
+        && (_FB(address + RecordSize(length) - KVSTORE_CRC_SIZE) == RecordCRC(key, length, &_FB(address + KVSTORE_HEADER_SIZE), ValueLength(length))))
+    {
+      if ((key == KVSTORE_KEY_COMMIT) && (length == 1))
+        ScanCommit(_FB(address + KVSTORE_HEADER_SIZE));
+      else if (Transactional(length))
+        Pending[NbPending++ % KVSTORE_MAX_TXN_RECORDS] = address;
+      else
+      {
+        NbPending = 0;
+        (void)IndexUpdate(key, length, address);
+      }
+    }
+
+    address += RecordSize(length);
+  }
+
+  if (sector == Head)
+    WriteAddress = (address < end) ? address : end;
+}
+
+bool KVStore_Format(void)
+{
+  for (uint8_t sector = 0; sector < KVSTORE_NB_SECTORS; sector++)
+  {
+    if (!SectorErased(sector) && !Flash_EraseSector(SectorAddress(sector)))
+      return false;
+  }
+
+  NbKeys = 0;
+  InTransaction = false;
+  Head = KVSTORE_NB_SECTORS - 1;
+  Sequence = 0;
+
+  return OpenNextSector();
+}
+
+bool KVStore_Init(void)
+{
+  bool found = false;
+  uint32_t sequence;
+
+  for (uint8_t sector = 0; sector < KVSTORE_NB_SECTORS; sector++)
+  {
+    if (SectorValid(sector))
+    {
+      sequence = _FW(SectorAddress(sector) + 4);
+      if (!found || (sequence > Sequence))
+      {
+        Head = sector;
+        Sequence = sequence;
+      }
+      found = true;
+    }
+    else if (!SectorErased(sector) && !Flash_EraseSector(SectorAddress(sector)))
+      return false;
+  }
+
+  if (!found)
+    return KVStore_Format();
+
+  // Oldest first, so newer records replace older ones in the index
+  NbKeys = 0;
+  InTransaction = false;
+  for (uint8_t i = 1; i <= KVSTORE_NB_SECTORS; i++)
+  {
+    uint8_t sector = (uint8_t)((Head + i) % KVSTORE_NB_SECTORS);
+
+    if (SectorValid(sector))
+      ScanSector(sector);
+  }
+
+  // Finish a garbage collection interrupted by a reset
+  if (SectorValid((uint8_t)((Head + 1) % KVSTORE_NB_SECTORS)))
+    return Collect((uint8_t)((Head + 1) % KVSTORE_NB_SECTORS));
+
+  return true;
+}
+
+/*! @brief Stages a write or delete in the open transaction.
+ *
+ *  A second update of the same key replaces the first.
+ *  @param length The value length, or KVSTORE_TOMBSTONE.
+ *  @return bool - FALSE if the transaction is full.
+ */
+static bool Stage(const uint16_t key, const uint8_t length, const uint8_t* const value)
+{
+  uint8_t i;
+
+  for (i = 0; (i < NbStaged) && (Staged[i].key != key); i++)
+    ;
+
+  if (i == NbStaged)
+  {
+    if (NbStaged >= KVSTORE_MAX_TXN_RECORDS)
+      return false;
+    NbStaged++;
+  }
+
+  Staged[i].key = key;
+  Staged[i].length = length;
+  for (uint8_t byte = 0; byte < ValueLength(length); byte++)
+    Staged[i].value[byte] = value[byte];
+
+  return true;
+}
+
+bool KVStore_Write(const uint16_t key, const void* const data, const uint8_t length)
+{
+  const uint8_t* value = (const uint8_t*)data;
+  TKVIndexEntry* entry;
+  uint8_t i;
+
+  if ((key >= KVSTORE_KEY_COMMIT) || (length > KVSTORE_MAX_VALUE_SIZE))
+    return false;
+
+  if (InTransaction)
+    return Stage(key, length, value);
+
+  // Unchanged values cost no Flash wear
+  entry = IndexFind(key);
+  if (entry && (PlainLength(_FB(entry->address + 2)) == length))
+  {
+    for (i = 0; (i < length) && (_FB(entry->address + KVSTORE_HEADER_SIZE + i) == value[i]); i++)
+      ;
+    if (i == length)
+      return true;
+  }
+
+  if (!entry && (NbKeys >= KVSTORE_MAX_KEYS))
+    return false;
+
+  if (WriteAddress + RecordSize(length) > SectorAddress(Head) + FLASH_SECTOR_SIZE)
+  {
+    if (!OpenNextSector())
+      return false;
+  }
+
+  return WriteRecord(key, length, value);
+}
+
+bool KVStore_Read(const uint16_t key, void* const data, const uint8_t size, uint8_t* const length)
+{
+  TKVIndexEntry* entry = IndexFind(key);
+  uint8_t* value = (uint8_t*)data;
+  uint8_t valueLength;
+
+  if (!entry)
+    return false;
+
+  valueLength = PlainLength(_FB(entry->address + 2));
+  for (uint8_t i = 0; (i < valueLength) && (i < size); i++)
+    value[i] = _FB(entry->address + KVSTORE_HEADER_SIZE + i);
+
+  if (length)
+    *length = valueLength;
+
+  return true;
+}
+
+bool KVStore_Delete(const uint16_t key)
+{
+  if (key >= KVSTORE_KEY_COMMIT)
+    return false;
+
+  if (InTransaction)
+    return Stage(key, KVSTORE_TOMBSTONE, NULL);
+
+  if (!IndexFind(key))
+    return true;
+
+  if (WriteAddress + RecordSize(KVSTORE_TOMBSTONE) > SectorAddress(Head) + FLASH_SECTOR_SIZE)
+  {
+    if (!OpenNextSector())
+      return false;
+  }
+
+  return WriteRecord(key, KVSTORE_TOMBSTONE, NULL);
+}
+
+bool KVStore_Begin(void)
+{
+  if (InTransaction)
+    return false;
+
+  InTransaction = true;
+  NbStaged = 0;
+  return true;
+}
+
+bool KVStore_Commit(void)
+{
+  uint32_t addresses[KVSTORE_MAX_TXN_RECORDS];
+  uint32_t size = RecordSize(1);
+  uint8_t newKeys = 0;
+  uint8_t i;
+
+  if (!InTransaction)
+    return false;
+
+  InTransaction = false;
+  if (NbStaged == 0)
+    return true;
+
+  // Check the index has room before anything is written
+  for (i = 0; i < NbStaged; i++)
+  {
+    if ((Staged[i].length != KVSTORE_TOMBSTONE) && !IndexFind(Staged[i].key))
+      newKeys++;
+    size += RecordSize(Staged[i].length);
+  }
+
+  if (NbKeys + newKeys > KVSTORE_MAX_KEYS)
+    return false;
+
+  // The whole transaction goes in one sector
+  if (WriteAddress + size > SectorAddress(Head) + FLASH_SECTOR_SIZE)
+  {
+    if (!OpenNextSector())
+      return false;
+  }
+
+  for (i = 0; i < NbStaged; i++)
+  {
+    addresses[i] = WriteAddress;
+    if (!ProgramRecord(Staged[i].key,
+                       (Staged[i].length == KVSTORE_TOMBSTONE) ? KVSTORE_TXN_TOMBSTONE : (uint8_t)(Staged[i].length | KVSTORE_TXN_FLAG),
+                       Staged[i].value))
+      return false;
+  }
+
+  // Nothing is visible after a reset until the marker is programmed
+  if (!ProgramRecord(KVSTORE_KEY_COMMIT, 1, &NbStaged))
+    return false;
+
+  for (i = 0; i < NbStaged; i++)
+    (void)IndexUpdate(Staged[i].key, Staged[i].length, addresses[i]);
+
+  return true;
+}
+
+void KVStore_Abort(void)
+{
+  InTransaction = false;
+}
@@ -0,0 +1,108 @@
+/*! @file
+ *
+ *  @brief Routines for a wear-levelled key-value store in Flash.
+ *
+ *  This contains the functions for storing small values against 16-bit keys in a log spread over several Flash sectors.
+ *  Each update is appended to the log, so a value of up to 4 bytes costs a single phrase program and no erase.
+ *  When the newest sector fills, the next sector is opened and the oldest sector's live records are copied into it
+ *  before the oldest sector is erased, so there is always one erased spare sector and erases rotate through the region.
+ *  An index of the newest record for each key is rebuilt in RAM by KVStore_Init.
+ *  Updates to several keys can be grouped in a transaction, so that after a reset either all or none of them are seen.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef KVSTORE_H
+#define KVSTORE_H
+
+// new types
+#include "Types\types.h"
+
+// Address of the first Flash sector used by the store, in the data area at the top of program flash block 1
+#define KVSTORE_START 0x000F8000LU
+// Number of Flash sectors used by the store (at least 2)
+#define KVSTORE_NB_SECTORS 4
+
+// Maximum number of keys that can be stored
+#define KVSTORE_MAX_KEYS 32
+// Maximum size of a value in bytes
+#define KVSTORE_MAX_VALUE_SIZE 64
+// Maximum number of keys updated by one transaction
+#define KVSTORE_MAX_TXN_RECORDS 8
+
+// Key value reserved for erased Flash
+#define KVSTORE_KEY_INVALID 0xFFFFu
+// Key value reserved for transaction commit markers
+#define KVSTORE_KEY_COMMIT  0xFFFEu
+
+/*! @brief Builds the RAM index from the records in Flash.
+ *
+ *  Sectors that are neither valid nor erased (e.g. after a reset during an erase) are erased.
+ *  If no valid sector is found, the store is formatted.
+ *  @return bool - TRUE if the store was successfully initialized.
+ *  @note Assumes Flash has been initialized.
+ */
+bool KVStore_Init(void);
+
+/*! @brief Erases all records.
+ *
+ *  @return bool - TRUE if the store was successfully formatted.
+ *  @note Assumes Flash has been initialized.
+ */
+bool KVStore_Format(void);
+
+/*! @brief Stores a value against a key, replacing any previous value.
+ *
+ *  Inside a transaction the value is only staged, and is written by KVStore_Commit.
+ *  @param key The key, which must be less than KVSTORE_KEY_COMMIT.
+ *  @param data A pointer to the value.
+ *  @param length The size of the value in bytes (0 to KVSTORE_MAX_VALUE_SIZE).
+ *  @return bool - TRUE if the value was written (or staged) successfully.
+ *  @note Assumes that KVStore_Init has been called.
+ */
+bool KVStore_Write(const uint16_t key, const void* const data, const uint8_t length);
+
+/*! @brief Retrieves the value stored against a key.
+ *
+ *  Values staged by an open transaction are not seen until it is committed.
+ *  @param key The key.
+ *  @param data A pointer to memory to store the value.
+ *  @param size The size of the memory at data in bytes - the value is truncated if it does not fit.
+ *  @param length The address of a variable to store the size of the value, or NULL.
+ *  @return bool - TRUE if the key was found.
+ *  @note Assumes that KVStore_Init has been called.
+ */
+bool KVStore_Read(const uint16_t key, void* const data, const uint8_t size, uint8_t* const length);
+
+/*! @brief Removes a key.
+ *
+ *  Inside a transaction the removal is only staged, and is written by KVStore_Commit.
+ *  @param key The key, which must be less than KVSTORE_KEY_COMMIT.
+ *  @return bool - TRUE if the key was removed (or the removal staged) or did not exist.
+ *  @note Assumes that KVStore_Init has been called.
+ */
+bool KVStore_Delete(const uint16_t key);
+
+/*! @brief Opens a transaction.
+ *
+ *  Subsequent calls to KVStore_Write and KVStore_Delete are staged in RAM until KVStore_Commit or KVStore_Abort.
+ *  @return bool - TRUE if the transaction was opened, FALSE if one is already open.
+ *  @note Assumes that KVStore_Init has been called.
+ */
+bool KVStore_Begin(void);
+
+/*! @brief Writes the staged updates followed by a commit marker, and closes the transaction.
+ *
+ *  The updates are written together in one sector, and KVStore_Init only applies them if it finds the marker,
+ *  so a reset during the commit leaves every key with its previous value.
+ *  @return bool - TRUE if the transaction was committed, FALSE if none is open, the index would overflow or programming failed.
+ *  @note Assumes that KVStore_Init has been called.
+ */
+bool KVStore_Commit(void);
+
+/*! @brief Discards the staged updates and closes the transaction.
+ */
+void KVStore_Abort(void);
+
+#endif
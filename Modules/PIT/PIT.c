@@ -0,0 +1,202 @@
+/*! @file
+ *
+ *  @brief Routines for controlling Periodic Interrupt Timer (PIT).
+ *
+ *  Each channel counts down from LDVAL to 0 at the module (bus) clock rate, then reloads and sets its interrupt flag.
+ *  The K64 PIT has no lifetime timer registers to latch both halves of a chained pair,
+ *  so the lifetime timer reads the upper half either side of the lower half instead.
+ *
+ *  @author PMcL
+ *  @date 2015-08-22
+ */
+
+#include <stddef.h>
+
+#include "PIT\PIT.h"
+#include "Critical\critical.h"
+#include "Reciprocal\reciprocal.h"
+#include "MK64F12.h"
+
+static uint32_t ModuleClk;
+
+// Converts nanoseconds to module clock ticks without dividing
+static uint64_t TicksPerNanosecond;
+
+// TRUE once channels 0 and 1 are the lifetime timer
+static bool LifetimeRunning;
+
+static void (*UserFunctions[PIT_NB_CHANNELS])(void*);
+static void* UserArguments[PIT_NB_CHANNELS];
+
+static const IRQn_Type IRQs[PIT_NB_CHANNELS] = {PIT0_IRQn, PIT1_IRQn, PIT2_IRQn, PIT3_IRQn};
+
+/*! @brief Checks whether a channel can be used as a periodic timer.
+ */
+static bool ChannelAvailable(const uint8_t channelNb)
+{
+  if (channelNb >= PIT_NB_CHANNELS)
+    return false;
+
+  return !LifetimeRunning || ((channelNb != PIT_LIFETIME_CHANNEL_LOW) && (channelNb != PIT_LIFETIME_CHANNEL_HIGH));
+}
+
+/*! @brief Clears a channel's interrupt flag and calls its user callback function.
+ */
+static void ChannelISR(const uint8_t channelNb)
+{
+  // Write 1 to clear
+  PIT->CHANNEL[channelNb].TFLG = PIT_TFLG_TIF_MASK;
+
+  if (UserFunctions[channelNb])
+    UserFunctions[channelNb](UserArguments[channelNb]);
+}
+
+bool PIT_Init(const uint32_t moduleClk)
+{
+  if ((moduleClk == 0) || (moduleClk > 1000000000u))
+    return false;
+
+  ModuleClk = moduleClk;
+  TicksPerNanosecond = Reciprocal_Init(moduleClk, 1000000000u);
+  LifetimeRunning = false;
+
+  SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+
+  // Enable the module, and stop the timers in debug mode
+  PIT->MCR = PIT_MCR_FRZ_MASK;
+
+  for (uint8_t channelNb = 0; channelNb < PIT_NB_CHANNELS; channelNb++)
+  {
+    PIT->CHANNEL[channelNb].TCTRL = 0;
+    PIT->CHANNEL[channelNb].TFLG = PIT_TFLG_TIF_MASK;
+    UserFunctions[channelNb] = NULL;
+
+    NVIC_SetPriority(IRQs[channelNb], CRITICAL_PRIORITY_DEFAULT);
+    NVIC_ClearPendingIRQ(IRQs[channelNb]);
+    NVIC_EnableIRQ(IRQs[channelNb]);
+  }
+
+  return true;
+}
+
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments)
+{
+  if (!ChannelAvailable(channelNb))
+    return false;
+
+  // Disable the channel's interrupt so it never sees a half-updated callback
+  NVIC_DisableIRQ(IRQs[channelNb]);
+  UserFunctions[channelNb] = userFunction;
+  UserArguments[channelNb] = userArguments;
+  NVIC_EnableIRQ(IRQs[channelNb]);
+
+  return true;
+}
+
+bool PIT_SetPriority(const uint8_t channelNb, const uint8_t priority)
+{
+  if (!ChannelAvailable(channelNb) || (priority > 15))
+    return false;
+
+  NVIC_SetPriority(IRQs[channelNb], priority);
+  return true;
+}
+
+bool PIT_Set(const uint8_t channelNb, const uint32_t period, const bool restart)
+{
+  uint32_t ticks;
+
+  if (!ChannelAvailable(channelNb))
+    return false;
+
+  // The timer counts LDVAL + 1 module clock periods
+  ticks = Reciprocal_Scale(period, TicksPerNanosecond);
+  if (ticks == 0)
+    return false;
+
+  if (restart)
+  {
+    PIT->CHANNEL[channelNb].TCTRL &= ~PIT_TCTRL_TEN_MASK;
+    PIT->CHANNEL[channelNb].LDVAL = ticks - 1;
+    PIT->CHANNEL[channelNb].TFLG = PIT_TFLG_TIF_MASK;
+  }
+  else
+    PIT->CHANNEL[channelNb].LDVAL = ticks - 1;
+
+  PIT->CHANNEL[channelNb].TCTRL |= PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK;
+  return true;
+}
+
+bool PIT_Enable(const uint8_t channelNb, const bool enable)
+{
+  if (!ChannelAvailable(channelNb))
+    return false;
+
+  if (enable)
+    PIT->CHANNEL[channelNb].TCTRL |= PIT_TCTRL_TEN_MASK;
+  else
+    PIT->CHANNEL[channelNb].TCTRL &= ~PIT_TCTRL_TEN_MASK;
+
+  return true;
+}
+
+bool PIT_LifetimeInit(void)
+{
+  if (LifetimeRunning)
+    return true;
+
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_LOW].TCTRL = 0;
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_HIGH].TCTRL = 0;
+
+  // Start the upper half first so that it sees the first expiry of the lower half
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_HIGH].LDVAL = 0xFFFFFFFFu;
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_HIGH].TCTRL = PIT_TCTRL_CHN_MASK | PIT_TCTRL_TEN_MASK;
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_LOW].LDVAL = 0xFFFFFFFFu;
+  PIT->CHANNEL[PIT_LIFETIME_CHANNEL_LOW].TCTRL = PIT_TCTRL_TEN_MASK;
+
+  LifetimeRunning = true;
+  return true;
+}
+
+uint64_t PIT_LifetimeTicks(void)
+{
+  uint32_t high, low;
+
+  // If the upper half changed while the lower half was read, the lower half wrapped - read again
+  do
+  {
+    high = PIT->CHANNEL[PIT_LIFETIME_CHANNEL_HIGH].CVAL;
+    low = PIT->CHANNEL[PIT_LIFETIME_CHANNEL_LOW].CVAL;
+  } while (high != PIT->CHANNEL[PIT_LIFETIME_CHANNEL_HIGH].CVAL);
+
+  // Both halves count down from all ones
+  return ((uint64_t)~high << 32) | (uint32_t)~low;
+}
+
+uint64_t PIT_LifetimeNanoseconds(void)
+{
+  uint64_t ticks = PIT_LifetimeTicks();
+
+  // Split the conversion so the intermediate product cannot overflow
+  return (ticks / ModuleClk) * 1000000000u + ((ticks % ModuleClk) * 1000000000u) / ModuleClk;
+}
+
+void __attribute__ ((interrupt)) PIT0_IRQHandler(void)
+{
+  ChannelISR(0);
+}
+
+void __attribute__ ((interrupt)) PIT1_IRQHandler(void)
+{
+  ChannelISR(1);
+}
+
+void __attribute__ ((interrupt)) PIT2_IRQHandler(void)
+{
+  ChannelISR(2);
+}
+
+void __attribute__ ((interrupt)) PIT3_IRQHandler(void)
+{
+  ChannelISR(3);
+}
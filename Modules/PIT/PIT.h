@@ -3,6 +3,9 @@
  *  @brief Routines for controlling Periodic Interrupt Timer (PIT).
  *
  *  This contains the functions for operating the periodic interrupt timer (PIT).
+ *  Each of the four channels has its own period, callback and interrupt.
+ *  Channels 0 and 1 can instead be chained into a 64-bit lifetime timer, which gives a monotonic timestamp
+ *  in module clock ticks that any context can read without interrupts or locks.
  *
  *  @author PMcL
  *  @date 2015-08-22
@@ -14,30 +17,94 @@
 // new types
 #include "Types\types.h"
 
+// Number of PIT channels
+#define PIT_NB_CHANNELS 4
+
+// Channels used by the lifetime timer - channel 1 counts the expiries of channel 0
+#define PIT_LIFETIME_CHANNEL_LOW  0
+#define PIT_LIFETIME_CHANNEL_HIGH 1
+
 /*! @brief Sets up the PIT before first use.
  *
- *  Enables the PIT and freezes the timer when debugging.
- *  @param moduleClk The module clock rate in Hz.
- *  @param userFunction is a pointer to a user callback function.
- *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  Enables the PIT and freezes the timer when debugging. All channels start disabled.
+ *  The conversion from nanoseconds to module clock ticks is precomputed, so PIT_Set does not divide.
+ *  @param moduleClk The module clock rate in Hz (up to 1 GHz).
  *  @return bool - TRUE if the PIT was successfully initialized.
- *  @note Assumes that moduleClk has a period which can be expressed as an integral number of nanoseconds.
  */
-bool PIT_Init(const uint32_t moduleClk, void (*userFunction)(void*), void* userArguments);
+bool PIT_Init(const uint32_t moduleClk);
 
-/*! @brief Sets the value of the desired period of the PIT.
+/*! @brief Sets the function called when a channel's period expires.
  *
+ *  @param channelNb The channel number (0 to PIT_NB_CHANNELS - 1).
+ *  @param userFunction is a pointer to a user callback function, or NULL.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the channel number is valid.
+ *  @note Assumes that PIT_Init has been called.
+ */
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Sets the NVIC priority of a channel's interrupt.
+ *
+ *  PIT_Init gives every channel CRITICAL_PRIORITY_DEFAULT.
+ *  @param channelNb The channel number (0 to PIT_NB_CHANNELS - 1).
+ *  @param priority The priority (0 to 15) - a callback that uses a FIFO must not be more urgent than CRITICAL_PRIORITY_CEILING.
+ *  @return bool - TRUE if the channel number and priority are valid.
+ *  @note Assumes that PIT_Init has been called.
+ */
+bool PIT_SetPriority(const uint8_t channelNb, const uint8_t priority);
+
+/*! @brief Sets the value of the desired period of a PIT channel.
+ *
+ *  @param channelNb The channel number (0 to PIT_NB_CHANNELS - 1).
  *  @param period The desired value of the timer period in nanoseconds.
- *  @param restart TRUE if the PIT is disabled, a new value set, and then enabled.
- *                 FALSE if the PIT will use the new value after a trigger event.
- *  @note The function will enable the timer and interrupts for the PIT.
+ *  @param restart TRUE if the channel is disabled, a new value set, and then enabled.
+ *                 FALSE if the channel will use the new value after a trigger event.
+ *  @return bool - TRUE if the period was set, FALSE if the channel number is invalid or the period is too short or too long.
+ *  @note The function will enable the timer and interrupts for the channel.
+ */
+bool PIT_Set(const uint8_t channelNb, const uint32_t period, const bool restart);
+
+/*! @brief Enables or disables a PIT channel.
+ *
+ *  @param channelNb The channel number (0 to PIT_NB_CHANNELS - 1).
+ *  @param enable - TRUE if the channel is to be enabled, FALSE if the channel is to be disabled.
+ *  @return bool - TRUE if the channel number is valid.
+ */
+bool PIT_Enable(const uint8_t channelNb, const bool enable);
+
+/*! @brief Starts the 64-bit lifetime timer on chained channels 0 and 1.
+ *
+ *  The channels then count freely and can no longer be used as periodic timers.
+ *  @return bool - TRUE if the lifetime timer was started.
+ *  @note Assumes that PIT_Init has been called.
+ */
+bool PIT_LifetimeInit(void);
+
+/*! @brief Gets the time since PIT_LifetimeInit in module clock ticks.
+ *
+ *  The two 32-bit halves are read until a consistent pair is seen, so it is safe from any context.
+ *  At a 60 MHz bus clock the count wraps after about 9700 years.
+ *  @return uint64_t - the number of module clock ticks.
+ *  @note Assumes that PIT_LifetimeInit has been called.
+ */
+uint64_t PIT_LifetimeTicks(void);
+
+/*! @brief Gets the time since PIT_LifetimeInit in nanoseconds.
+ *
+ *  @return uint64_t - the number of nanoseconds.
+ *  @note Assumes that PIT_LifetimeInit has been called.
  */
-void PIT_Set(const uint32_t period, const bool restart);
+uint64_t PIT_LifetimeNanoseconds(void);
 
-/*! @brief Enables or disables the PIT.
+/*! @brief Interrupt service routines for the PIT channels.
  *
- *  @param enable - TRUE if the PIT is to be enabled, FALSE if the PIT is to be disabled.
+ *  The periodic interrupt timer has timed out.
+ *  The interrupt flag is cleared and the channel's user callback function is called.
+ *  @note Assumes the PIT has been initialized.
  */
-void PIT_Enable(const bool enable);
+void __attribute__ ((interrupt)) PIT0_IRQHandler(void);
+void __attribute__ ((interrupt)) PIT1_IRQHandler(void);
+void __attribute__ ((interrupt)) PIT2_IRQHandler(void);
+void __attribute__ ((interrupt)) PIT3_IRQHandler(void);
 
 #endif
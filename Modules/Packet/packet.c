@@ -0,0 +1,163 @@
+/*! @file
+ *
+ *  @brief Routines to implement packet encoding and decoding for the serial port.
+ *
+ *  This contains the functions for implementing the Simple Serial Communication Protocol.
+ *
+ *  @author PMcL
+ *  @date 2015-07-23
+ */
+
+#include "Packet\packet.h"
+#include "UART\UART.h"
+#include "MK64F12.h"
+#include "system_MK64F12.h"
+
+TPacket Packet;
+
+const uint8_t PACKET_ACK_MASK = 0x80u;
+
+/*!
+ * @enum TBaudState
+ */
+typedef enum
+{
+  BAUD_STATE_IDLE,            /*!< Running at an agreed baud rate */
+  BAUD_STATE_SWITCH_PENDING,  /*!< Waiting for the reply to leave the transmitter */
+  BAUD_STATE_CONFIRM_PENDING  /*!< Waiting for a valid packet at the new baud rate */
+} TBaudState;
+
+static uint32_t ModuleClk;
+static uint32_t BaudRate;
+static uint32_t NewBaudRate;
+static TBaudState BaudState;
+static uint32_t SwitchTime;  // Cycle count when the new baud rate was set
+
+// Number of bytes of the packet received so far
+static uint8_t NbBytesReceived;
+
+/*! @brief Calculates the checksum of a packet.
+ *
+ *  @return uint8_t - the XOR of the command and parameters.
+ */
+static uint8_t Checksum(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3)
+{
+  return command ^ parameter1 ^ parameter2 ^ parameter3;
+}
+
+/*! @brief Advances the baud rate negotiation.
+ *
+ *  Switches once the reply has been sent, and falls back if the new baud rate is not confirmed in time.
+ *  The timeout is measured with the DWT cycle counter, which runs at the core clock.
+ */
+static void BaudRatePoll(void)
+{
+  switch (BaudState)
+  {
+    case BAUD_STATE_SWITCH_PENDING:
+      if (UART_TxComplete())
+      {
+        (void)UART_SetBaudRate(ModuleClk, NewBaudRate);
+        NbBytesReceived = 0;
+        SwitchTime = DWT->CYCCNT;
+        BaudState = BAUD_STATE_CONFIRM_PENDING;
+      }
+      break;
+
+    case BAUD_STATE_CONFIRM_PENDING:
+      if (DWT->CYCCNT - SwitchTime > (SystemCoreClock / 1000u) * PACKET_BAUD_RATE_TIMEOUT_MS)
+      {
+        (void)UART_SetBaudRate(ModuleClk, BaudRate);
+        NbBytesReceived = 0;
+        BaudState = BAUD_STATE_IDLE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+bool Packet_Init(const uint32_t moduleClk, const uint32_t baudRate)
+{
+  ModuleClk = moduleClk;
+  BaudRate = baudRate;
+  BaudState = BAUD_STATE_IDLE;
+  NbBytesReceived = 0;
+
+  // Enable the cycle counter for the baud rate fallback timeout
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  return UART_Init(moduleClk, baudRate);
+}
+
+bool Packet_Get(void)
+{
+  uint8_t data;
+
+  BaudRatePoll();
+
+  while (UART_InChar(&data))
+  {
+    Packet.bytes[NbBytesReceived++] = data;
+
+    if (NbBytesReceived == PACKET_NB_BYTES)
+    {
+      if (Packet_Checksum == Checksum(Packet_Command, Packet_Parameter1, Packet_Parameter2, Packet_Parameter3))
+      {
+        NbBytesReceived = 0;
+
+        // A valid packet at the new baud rate confirms the switch
+        if (BaudState == BAUD_STATE_CONFIRM_PENDING)
+        {
+          BaudRate = NewBaudRate;
+          BaudState = BAUD_STATE_IDLE;
+        }
+
+        return true;
+      }
+
+      // Out of sync - discard the oldest byte and try again
+      for (uint8_t i = 0; i < PACKET_NB_BYTES - 1; i++)
+        Packet.bytes[i] = Packet.bytes[i + 1];
+      NbBytesReceived--;
+    }
+  }
+
+  return false;
+}
+
+bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3)
+{
+  return UART_OutChar(command)
+      && UART_OutChar(parameter1)
+      && UART_OutChar(parameter2)
+      && UART_OutChar(parameter3)
+      && UART_OutChar(Checksum(command, parameter1, parameter2, parameter3));
+}
+
+bool Packet_HandleBaudRate(void)
+{
+  uint32_t requested, actual;
+  bool accepted;
+
+  requested = (uint32_t)Packet_Parameter1 | ((uint32_t)Packet_Parameter2 << 8) | ((uint32_t)Packet_Parameter3 << 16);
+
+  // Only one negotiation at a time
+  accepted = (BaudState == BAUD_STATE_IDLE) && UART_CheckBaudRate(ModuleClk, requested, &actual);
+  if (!accepted)
+    actual = BaudRate;
+
+  if (!Packet_Put(accepted ? (PACKET_CMD_BAUD_RATE | PACKET_ACK_MASK) : PACKET_CMD_BAUD_RATE,
+                  (uint8_t)actual, (uint8_t)(actual >> 8), (uint8_t)(actual >> 16)))
+    return false;
+
+  if (accepted)
+  {
+    NewBaudRate = requested;
+    BaudState = BAUD_STATE_SWITCH_PENDING;
+  }
+
+  return accepted;
+}
@@ -64,6 +64,12 @@ extern TPacket Packet;
 // Acknowledgment bit mask
 extern const uint8_t PACKET_ACK_MASK;
 
+// Baud rate negotiation command
+#define PACKET_CMD_BAUD_RATE 0x0E
+
+// Time to wait for a valid packet at a new baud rate before falling back to the old one
+#define PACKET_BAUD_RATE_TIMEOUT_MS 1000
+
 /*! @brief Initializes the packets by calling the initialization routines of the supporting software modules.
  *
  *  @param moduleClk The module clock rate in Hz.
@@ -84,4 +90,16 @@ bool Packet_Get(void);
  */
 bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3);
 
+/*! @brief Handles a baud rate negotiation packet.
+ *
+ *  The requested baud rate is in parameters 1 (LSB) to 3 (MSB).
+ *  A reply is always sent at the current baud rate, with the acknowledgment bit set if the baud rate is accepted
+ *  and parameters 1 to 3 holding the baud rate that will actually be generated.
+ *  Both sides switch once the last stop bit of the reply has been sent.
+ *  If no valid packet is received within PACKET_BAUD_RATE_TIMEOUT_MS of the switch, the old baud rate is restored.
+ *  @return bool - TRUE if the requested baud rate was accepted.
+ *  @note Assumes that Packet_Get has returned a PACKET_CMD_BAUD_RATE packet.
+ */
+bool Packet_HandleBaudRate(void);
+
 #endif
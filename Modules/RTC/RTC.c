@@ -0,0 +1,241 @@
+/*! @file
+ *
+ *  @brief Routines for controlling the Real Time Clock (RTC).
+ *
+ *  The time seconds register counts each time bit 14 of the prescaler falls, so the low 15 bits of the prescaler
+ *  are the fraction of the current second. Both registers are clocked from the 32.768 kHz oscillator,
+ *  so they are read until two passes agree rather than by stopping the counter.
+ *  The alarm flag is set when the time seconds register increments from the alarm register, so the alarm register holds
+ *  the second before the alarm time. Writing the alarm register clears the flag.
+ *  The calendar conversions count days from 0000-03-01, so that leap days fall at the end of each year.
+ *
+ *  @author PMcL
+ *  @date 2015-08-24
+ */
+
+#include <stddef.h>
+
+#include "RTC\RTC.h"
+#include "Critical\critical.h"
+#include "MK64F12.h"
+
+// Seconds per day
+#define RTC_SECONDS_PER_DAY 86400u
+
+// Days from 0000-03-01 to 1970-01-01
+#define RTC_EPOCH_DAYS 719468u
+
+// Days in a 400 year cycle of the Gregorian calendar
+#define RTC_DAYS_PER_ERA 146097u
+
+// Busy-wait loops for the 32.768 kHz oscillator to start, as in the SDK examples
+#define RTC_OSC_STARTUP_LOOPS 0x600000u
+
+// Last second the 32-bit counter can hold - 2106-02-07 06:28:15
+#define RTC_LAST_YEAR 2106
+
+static void (*UserFunction)(void*);
+static void* UserArguments;
+
+static void (*AlarmFunction)(void*);
+static void* AlarmArguments;
+
+/*! @brief Checks for a leap year.
+ */
+static bool LeapYear(const uint32_t year)
+{
+  return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+bool RTC_Init(void (*userFunction)(void*), void* userArguments)
+{
+  SIM->SCGC6 |= SIM_SCGC6_RTC_MASK;
+
+  // The control register stays locked across resets while the RTC is powered
+  if (!(RTC->CR & RTC_CR_OSCE_MASK))
+  {
+    // 10 pF load, as in the board clock configuration
+    RTC->CR = RTC_CR_OSCE_MASK | RTC_CR_SC2P_MASK | RTC_CR_SC8P_MASK;
+    for (volatile uint32_t i = 0; i < RTC_OSC_STARTUP_LOOPS; i++)
+      ;
+    RTC->LR &= ~RTC_LR_CRL_MASK;
+  }
+
+  // The time is invalid after the RTC loses power or overflows - writing the seconds register clears the flags
+  if (RTC->SR & (RTC_SR_TIF_MASK | RTC_SR_TOF_MASK))
+  {
+    RTC->SR = 0;
+    RTC->TPR = 0;
+    RTC->TSR = 0;
+  }
+  RTC->SR = RTC_SR_TCE_MASK;
+
+  UserFunction = userFunction;
+  UserArguments = userArguments;
+  RTC->IER = userFunction ? RTC_IER_TSIE_MASK : 0;
+
+  NVIC_SetPriority(RTC_Seconds_IRQn, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_SetPriority(RTC_IRQn, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_ClearPendingIRQ(RTC_Seconds_IRQn);
+  NVIC_EnableIRQ(RTC_Seconds_IRQn);
+  NVIC_ClearPendingIRQ(RTC_IRQn);
+  NVIC_EnableIRQ(RTC_IRQn);
+
+  return true;
+}
+
+void RTC_Set(const uint8_t hours, const uint8_t minutes, const uint8_t seconds)
+{
+  TRTCTimestamp timestamp;
+
+  RTC_GetTimestamp(&timestamp);
+  RTC_SetTimestamp(timestamp.seconds - (timestamp.seconds % RTC_SECONDS_PER_DAY)
+                   + (uint32_t)hours * 3600 + (uint32_t)minutes * 60 + seconds);
+}
+
+void RTC_Get(uint8_t* const hours, uint8_t* const minutes, uint8_t* const seconds)
+{
+  TRTCTimestamp timestamp;
+  uint32_t timeOfDay;
+
+  RTC_GetTimestamp(&timestamp);
+  timeOfDay = timestamp.seconds % RTC_SECONDS_PER_DAY;
+
+  *hours = (uint8_t)(timeOfDay / 3600);
+  *minutes = (uint8_t)((timeOfDay / 60) % 60);
+  *seconds = (uint8_t)(timeOfDay % 60);
+}
+
+void RTC_SetTimestamp(const uint32_t seconds)
+{
+  // The counter must be stopped to write it, and the prescaler is written first since writing the seconds clears the flags
+  EnterCritical();
+  RTC->SR = 0;
+  RTC->TPR = 0;
+  RTC->TSR = seconds;
+  RTC->SR = RTC_SR_TCE_MASK;
+  ExitCritical();
+}
+
+void RTC_GetTimestamp(TRTCTimestamp* const timestamp)
+{
+  uint32_t seconds, prescaler;
+
+  // A second boundary or a prescaler tick between the reads shows up as a mismatch
+  do
+  {
+    seconds = RTC->TSR;
+    prescaler = RTC->TPR;
+  } while ((seconds != RTC->TSR) || (prescaler != RTC->TPR));
+
+  timestamp->seconds = seconds;
+  timestamp->subseconds = (uint16_t)(prescaler & (RTC_SUBSECONDS_PER_SECOND - 1));
+}
+
+void RTC_ToCalendar(const uint32_t seconds, TRTCCalendar* const calendar)
+{
+  uint32_t days = seconds / RTC_SECONDS_PER_DAY;
+  uint32_t timeOfDay = seconds % RTC_SECONDS_PER_DAY;
+  uint32_t era, dayOfEra, yearOfEra, dayOfYear, monthIndex;
+
+  calendar->hours = (uint8_t)(timeOfDay / 3600);
+  calendar->minutes = (uint8_t)((timeOfDay / 60) % 60);
+  calendar->seconds = (uint8_t)(timeOfDay % 60);
+
+  // 1970-01-01 was a Thursday
+  calendar->weekday = (uint8_t)((days + 4) % 7);
+
+  // Years start on 1 March, so February is last and its leap day does not move the other months
+  days += RTC_EPOCH_DAYS;
+  era = days / RTC_DAYS_PER_ERA;
+  dayOfEra = days - era * RTC_DAYS_PER_ERA;
+  yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / (RTC_DAYS_PER_ERA - 1)) / 365;
+  dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  monthIndex = (5 * dayOfYear + 2) / 153;
+
+  calendar->day = (uint8_t)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+  calendar->month = (uint8_t)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+  calendar->year = (uint16_t)(yearOfEra + era * 400 + (calendar->month <= 2 ? 1 : 0));
+}
+
+bool RTC_FromCalendar(const TRTCCalendar* const calendar, uint32_t* const seconds)
+{
+  static const uint8_t DaysInMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  uint32_t year = calendar->year;
+  uint32_t month = calendar->month;
+  uint32_t era, yearOfEra, dayOfYear, days;
+  uint64_t total;
+
+  if ((year < 1970) || (year > RTC_LAST_YEAR) || (month < 1) || (month > 12) || (calendar->day < 1)
+      || (calendar->day > DaysInMonth[month - 1] + ((month == 2) && LeapYear(year) ? 1 : 0))
+      || (calendar->hours > 23) || (calendar->minutes > 59) || (calendar->seconds > 59))
+    return false;
+
+  // Years start on 1 March, so January and February belong to the year before
+  if (month <= 2)
+    year--;
+  era = year / 400;
+  yearOfEra = year - era * 400;
+  dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + calendar->day - 1;
+  days = era * RTC_DAYS_PER_ERA + yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear - RTC_EPOCH_DAYS;
+
+  total = (uint64_t)days * RTC_SECONDS_PER_DAY
+          + (uint32_t)calendar->hours * 3600 + (uint32_t)calendar->minutes * 60 + calendar->seconds;
+  if (total > 0xFFFFFFFFu)
+    return false;
+
+  *seconds = (uint32_t)total;
+  return true;
+}
+
+bool RTC_SetAlarm(const uint32_t seconds, void (*userFunction)(void*), void* userArguments)
+{
+  bool success = true;
+
+  EnterCritical();
+  RTC->IER &= ~RTC_IER_TAIE_MASK;
+  RTC->TAR = 0;
+
+  if (seconds)
+  {
+    // The second before the alarm, so the flag is set as the time reaches it
+    success = ((int32_t)(seconds - RTC->TSR) > 0);
+    if (success)
+    {
+      AlarmFunction = userFunction;
+      AlarmArguments = userArguments;
+      RTC->TAR = seconds - 1;
+      RTC->IER |= RTC_IER_TAIE_MASK;
+
+      // If the time reached the alarm before the alarm register was written, the flag will never be set
+      if (((int32_t)(seconds - RTC->TSR) <= 0) && !(RTC->SR & RTC_SR_TAF_MASK))
+      {
+        RTC->IER &= ~RTC_IER_TAIE_MASK;
+        RTC->TAR = 0;
+        success = false;
+      }
+    }
+  }
+  ExitCritical();
+
+  return success;
+}
+
+void __attribute__ ((interrupt)) RTC_IRQHandler(void)
+{
+  if (!(RTC->SR & RTC_SR_TAF_MASK))
+    return;
+
+  // Writing the alarm register clears the flag
+  RTC->IER &= ~RTC_IER_TAIE_MASK;
+  RTC->TAR = 0;
+
+  if (AlarmFunction)
+    AlarmFunction(AlarmArguments);
+}
+
+void __attribute__ ((interrupt)) RTC_Seconds_IRQHandler(void)
+{
+  if (UserFunction)
+    UserFunction(UserArguments);
+}
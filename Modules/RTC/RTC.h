@@ -3,6 +3,10 @@
  *  @brief Routines for controlling the Real Time Clock (RTC).
  *
  *  This contains the functions for operating the real time clock (RTC).
+ *  The time is kept as seconds since the Unix epoch (1970-01-01 00:00:00 UTC) in the time seconds register,
+ *  with the fraction of a second in the 32.768 kHz prescaler, so timestamps have a resolution of about 30.5 us.
+ *  Calendar conversions cover 1970 to 2106, the range of the 32-bit seconds counter.
+ *  The alarm can wake the processor from the low-leakage stop modes through the LLWU.
  *
  *  @author PMcL
  *  @date 2015-08-24
@@ -14,17 +18,44 @@
 // new types
 #include "Types\types.h"
 
+// Prescaler counts per second
+#define RTC_SUBSECONDS_PER_SECOND 32768u
+
+/*!
+ * @struct TRTCTimestamp
+ */
+typedef struct
+{
+  uint32_t seconds;      /*!< Seconds since 1970-01-01 00:00:00 UTC */
+  uint16_t subseconds;   /*!< Fraction of the second in 1/RTC_SUBSECONDS_PER_SECOND (0-32767) */
+} TRTCTimestamp;
+
+/*!
+ * @struct TRTCCalendar
+ */
+typedef struct
+{
+  uint16_t year;         /*!< Year (1970-2106) */
+  uint8_t month;         /*!< Month (1-12) */
+  uint8_t day;           /*!< Day of the month (1-31) */
+  uint8_t hours;         /*!< Hours (0-23) */
+  uint8_t minutes;       /*!< Minutes (0-59) */
+  uint8_t seconds;       /*!< Seconds (0-59) */
+  uint8_t weekday;       /*!< Day of the week (0 = Sunday) - ignored by RTC_FromCalendar */
+} TRTCCalendar;
+
 /*! @brief Initializes the RTC before first use.
  *
  *  Sets up the control register for the RTC and locks it.
  *  Enables the RTC and sets an interrupt every second.
+ *  The time survives resets while the RTC is powered. If it has been lost, the RTC restarts from the epoch.
  *  @param userFunction is a pointer to a user callback function.
  *  @param userArguments is a pointer to the user arguments to use with the user callback function.
  *  @return bool - TRUE if the RTC was successfully initialized.
  */
 bool RTC_Init(void (*userFunction)(void*), void* userArguments);
 
-/*! @brief Sets the value of the real time clock.
+/*! @brief Sets the time of day, keeping the date.
  *
  *  @param hours The desired value of the real time clock hours (0-23).
  *  @param minutes The desired value of the real time clock minutes (0-59).
@@ -33,7 +64,7 @@ bool RTC_Init(void (*userFunction)(void*), void* userArguments);
  */
 void RTC_Set(const uint8_t hours, const uint8_t minutes, const uint8_t seconds);
 
-/*! @brief Gets the value of the real time clock.
+/*! @brief Gets the time of day.
  *
  *  @param hours The address of a variable to store the real time clock hours.
  *  @param minutes The address of a variable to store the real time clock minutes.
@@ -42,4 +73,61 @@ void RTC_Set(const uint8_t hours, const uint8_t minutes, const uint8_t seconds);
  */
 void RTC_Get(uint8_t* const hours, uint8_t* const minutes, uint8_t* const seconds);
 
+/*! @brief Sets the time.
+ *
+ *  The prescaler is cleared, so the next second starts now.
+ *  @param seconds The number of seconds since 1970-01-01 00:00:00 UTC.
+ *  @note Assumes that the RTC module has been initialized.
+ */
+void RTC_SetTimestamp(const uint32_t seconds);
+
+/*! @brief Gets the time with the fraction of a second.
+ *
+ *  The seconds and prescaler registers are read until a consistent pair is seen, so the counter keeps running
+ *  and it is safe from any context.
+ *  @param timestamp The address to store the time.
+ *  @note Assumes that the RTC module has been initialized.
+ */
+void RTC_GetTimestamp(TRTCTimestamp* const timestamp);
+
+/*! @brief Converts seconds since the epoch to a calendar date and time.
+ *
+ *  @param seconds The number of seconds since 1970-01-01 00:00:00 UTC.
+ *  @param calendar The address to store the date and time.
+ */
+void RTC_ToCalendar(const uint32_t seconds, TRTCCalendar* const calendar);
+
+/*! @brief Converts a calendar date and time to seconds since the epoch.
+ *
+ *  @param calendar The date and time.
+ *  @param seconds The address to store the number of seconds since 1970-01-01 00:00:00 UTC.
+ *  @return bool - TRUE if the date and time are valid and within the range of the RTC.
+ */
+bool RTC_FromCalendar(const TRTCCalendar* const calendar, uint32_t* const seconds);
+
+/*! @brief Sets the alarm.
+ *
+ *  The alarm goes off as the time reaches the given second. Setting it again replaces the earlier alarm.
+ *  @param seconds The number of seconds since 1970-01-01 00:00:00 UTC, or 0 to cancel the alarm.
+ *  @param userFunction is a pointer to a user callback function called from the RTC interrupt, or NULL.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the alarm was set or cancelled, FALSE if the time has already been reached.
+ *  @note Assumes that the RTC module has been initialized.
+ */
+bool RTC_SetAlarm(const uint32_t seconds, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Interrupt service routine for the RTC alarm.
+ *
+ *  Cancels the alarm and calls its user callback function.
+ *  @note Assumes the RTC has been initialized.
+ */
+void __attribute__ ((interrupt)) RTC_IRQHandler(void);
+
+/*! @brief Interrupt service routine for the RTC seconds interrupt.
+ *
+ *  Calls the user callback function once per second.
+ *  @note Assumes the RTC has been initialized.
+ */
+void __attribute__ ((interrupt)) RTC_Seconds_IRQHandler(void);
+
 #endif
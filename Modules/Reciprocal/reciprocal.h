@@ -0,0 +1,59 @@
+/*! @file
+ *
+ *  @brief Division-free scaling by a fixed ratio using a precomputed reciprocal.
+ *
+ *  This contains the functions for converting between units whose ratio is fixed at start-up, such as nanoseconds to timer ticks:
+ *    Reciprocal_Init(numerator, denominator)   - computes the reciprocal of the ratio, dividing once.
+ *    Reciprocal_Scale(value, reciprocal)       - returns floor(value * numerator / denominator) using two 32x32 multiplies and a shift.
+ *  The reciprocal is ceil(numerator * 2^62 / denominator). Its error is under 1 / 2^62, so for any 32-bit value the error in the product
+ *  is under 2^32 / 2^62, which is less than 1 / denominator - the smallest distance from the exact quotient to the next integer.
+ *  The scaled value is therefore always exactly the rounded-down quotient.
+ *  Both functions are inline, so a constant ratio gives a constant reciprocal at compile time.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef RECIPROCAL_H
+#define RECIPROCAL_H
+
+// new types
+#include "Types\types.h"
+
+// Fixed-point position of the reciprocal
+#define RECIPROCAL_SHIFT 62
+
+/*! @brief Computes the reciprocal of a ratio.
+ *
+ *  @param numerator The numerator of the ratio.
+ *  @param denominator The denominator of the ratio (up to 2^30).
+ *  @return uint64_t - the reciprocal, ceil(numerator * 2^62 / denominator).
+ *  @note Assumes that 0 < numerator <= denominator.
+ */
+static inline uint64_t Reciprocal_Init(const uint32_t numerator, const uint32_t denominator)
+{
+  // numerator * 2^62 does not fit in 64 bits, so divide in two steps of 32 and 30 bits
+  uint64_t upper = ((uint64_t)numerator << 32) / denominator;
+  uint64_t remainder = ((uint64_t)numerator << 32) % denominator;
+  uint64_t lower = (remainder << (RECIPROCAL_SHIFT - 32)) / denominator;
+
+  remainder = (remainder << (RECIPROCAL_SHIFT - 32)) % denominator;
+  return (upper << (RECIPROCAL_SHIFT - 32)) + lower + (remainder ? 1 : 0);
+}
+
+/*! @brief Scales a value by a ratio.
+ *
+ *  @param value The value to scale.
+ *  @param reciprocal The reciprocal of the ratio from Reciprocal_Init.
+ *  @return uint32_t - floor(value * numerator / denominator).
+ */
+static inline uint32_t Reciprocal_Scale(const uint32_t value, const uint64_t reciprocal)
+{
+  // The 96-bit product, shifted right by 62, from two 32x32 multiplies
+  uint64_t low = (uint64_t)value * (uint32_t)reciprocal;
+  uint64_t high = (uint64_t)value * (uint32_t)(reciprocal >> 32);
+
+  return (uint32_t)((high + (low >> 32)) >> (RECIPROCAL_SHIFT - 32));
+}
+
+#endif
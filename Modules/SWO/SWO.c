@@ -0,0 +1,33 @@
+/*! @file
+ *
+ *  @brief Routines for writing text to the debugger over SWO.
+ *
+ *  This contains the functions for writing strings and numbers to ITM stimulus port 0.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include "SWO\SWO.h"
+#include "MK64F12.h"
+
+void SWO_PutString(const char* str)
+{
+  while (*str)
+    (void)ITM_SendChar((uint32_t)*str++);
+}
+
+void SWO_PutNumber(uint32_t number)
+{
+  char digits[10];
+  uint8_t nbDigits = 0;
+
+  do
+  {
+    digits[nbDigits++] = (char)('0' + number % 10u);
+    number /= 10u;
+  } while (number);
+
+  while (nbDigits)
+    (void)ITM_SendChar((uint32_t)digits[--nbDigits]);
+}
@@ -0,0 +1,30 @@
+/*! @file
+ *
+ *  @brief Routines for writing text to the debugger over SWO.
+ *
+ *  This contains the functions used by the profiling and benchmark code to report results.
+ *  Text goes to ITM stimulus port 0, and is dropped if the debugger has not enabled it.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef SWO_H
+#define SWO_H
+
+// new types
+#include "Types\types.h"
+
+/*! @brief Writes a string to ITM stimulus port 0.
+ *
+ *  @param str The null-terminated string to write.
+ */
+void SWO_PutString(const char* str);
+
+/*! @brief Writes an unsigned decimal number to ITM stimulus port 0.
+ *
+ *  @param number The number to write.
+ */
+void SWO_PutNumber(uint32_t number);
+
+#endif
@@ -0,0 +1,468 @@
+/*! @file
+ *
+ *  @brief Routines for software timers multiplexed on one PIT channel.
+ *
+ *  The wheel has 6 levels of 64 slots, and level n holds timers that expire within 64^(n+1) ticks.
+ *  A timer goes in the level of the highest 6-bit group in which its expiry tick differs from now,
+ *  so a slot at level 0 only ever holds timers that expire on the tick it is reached.
+ *  When the lower bits of now roll over, the next slot of the level above is moved down.
+ *  Each timer moves down at most 5 times, so expiry takes constant time per timer.
+ *  A bitmap of occupied slots per level finds the next expiry or cascade for tickless mode.
+ *  In tickless mode the tick count follows the PIT lifetime timer, and the wheel skips ahead over empty ticks.
+ *  Deadlines are measured from the lifetime timer rather than by adding intervals, so interrupt latency never accumulates.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "TimerWheel\TimerWheel.h"
+#include "Critical\critical.h"
+#include "PIT\PIT.h"
+
+#ifdef TIMERWHEEL_TICKLESS
+#include "fsl_smc.h"
+#endif
+
+// Wheel geometry - the levels cover all 32 bits of the tick count
+#define TIMERWHEEL_SLOT_BITS  6
+#define TIMERWHEEL_NB_SLOTS   (1u << TIMERWHEEL_SLOT_BITS)
+#define TIMERWHEEL_SLOT_MASK  (TIMERWHEEL_NB_SLOTS - 1)
+#define TIMERWHEEL_NB_LEVELS  6
+
+#ifdef TIMERWHEEL_TICKLESS
+// Limits on the time programmed into the PIT channel in nanoseconds - a long sleep simply wakes early and sleeps again
+#define TIMERWHEEL_MIN_SLEEP 1000u
+#define TIMERWHEEL_MAX_SLEEP 1000000000u
+#endif
+
+/*!
+ * @struct TTimerWheelTimer
+ */
+typedef struct TTimerWheelTimer
+{
+  struct TTimerWheelTimer* next;    /*!< The next timer in the slot or the free list */
+  struct TTimerWheelTimer** link;   /*!< The pointer to this timer in its slot, or NULL if the timer is not running */
+  uint32_t expiry;                  /*!< The tick on which the timer expires */
+  uint32_t period;                  /*!< The ticks between expiries, or 0 for a one-shot timer */
+  void (*userFunction)(void*);      /*!< The user callback function */
+  void* userArguments;              /*!< The user arguments */
+  uint16_t generation;              /*!< Incremented each time the timer is taken from the pool */
+  uint8_t level;                    /*!< The level of the slot holding the timer */
+  uint8_t slot;                     /*!< The slot holding the timer */
+} TTimerWheelTimer;
+
+static TTimerWheelTimer Timers[TIMERWHEEL_NB_TIMERS];
+static TTimerWheelTimer* FreeTimers;
+
+static TTimerWheelTimer* Slots[TIMERWHEEL_NB_LEVELS][TIMERWHEEL_NB_SLOTS];
+static uint64_t Occupied[TIMERWHEEL_NB_LEVELS];
+
+static uint32_t Now;
+
+#ifdef TIMERWHEEL_TICKLESS
+static uint8_t Channel;
+static uint32_t TickPeriod;
+static uint64_t StartTime;
+static bool Advancing;  // Set while Advance is expiring timers, so Now stays on the tick being expired
+#endif
+
+/*! @brief Adds a timer to the slot for its expiry tick.
+ */
+static void Insert(TTimerWheelTimer* const timer)
+{
+  uint32_t differ = timer->expiry ^ Now;
+  uint8_t level = differ ? (uint8_t)((31 - __builtin_clz(differ)) / TIMERWHEEL_SLOT_BITS) : 0;
+  uint8_t index = (uint8_t)((timer->expiry >> (level * TIMERWHEEL_SLOT_BITS)) & TIMERWHEEL_SLOT_MASK);
+  TTimerWheelTimer** slot = &Slots[level][index];
+
+  timer->level = level;
+  timer->slot = index;
+  Occupied[level] |= 1ull << index;
+
+  timer->next = *slot;
+  if (timer->next)
+    timer->next->link = &timer->next;
+  timer->link = slot;
+  *slot = timer;
+}
+
+/*! @brief Removes a timer from its slot.
+ */
+static void Remove(TTimerWheelTimer* const timer)
+{
+  *timer->link = timer->next;
+  if (timer->next)
+    timer->next->link = timer->link;
+  timer->link = NULL;
+
+  if (!Slots[timer->level][timer->slot])
+    Occupied[timer->level] &= ~(1ull << timer->slot);
+}
+
+/*! @brief Returns a timer to the pool.
+ */
+static void Free(TTimerWheelTimer* const timer)
+{
+  timer->next = FreeTimers;
+  FreeTimers = timer;
+}
+
+/*! @brief Moves the timers in a slot down to the lower levels.
+ */
+static void Cascade(const uint8_t level, const uint8_t index)
+{
+  TTimerWheelTimer* timer = Slots[level][index];
+  TTimerWheelTimer* next;
+
+  Slots[level][index] = NULL;
+  Occupied[level] &= ~(1ull << index);
+  while (timer)
+  {
+    next = timer->next;
+    Insert(timer);
+    timer = next;
+  }
+}
+
+/*! @brief Gets the timer referred to by a handle.
+ *
+ *  @return TTimerWheelTimer* - the timer, or NULL if the handle is stale or invalid.
+ */
+static TTimerWheelTimer* Lookup(const TTimerWheelHandle handle)
+{
+  uint16_t index = (uint16_t)handle;
+
+  if ((index >= TIMERWHEEL_NB_TIMERS) || (Timers[index].generation != (uint16_t)(handle >> 16)))
+    return NULL;
+
+  return &Timers[index];
+}
+
+#ifdef TIMERWHEEL_TICKLESS
+/*! @brief Finds the first occupied slot of a level at or after an index.
+ *
+ *  @return int8_t - the slot, or -1 if there is none.
+ */
+static int8_t NextOccupied(const uint8_t level, const uint8_t from)
+{
+  uint64_t mask;
+
+  if (from >= TIMERWHEEL_NB_SLOTS)
+    return -1;
+
+  mask = Occupied[level] & (~0ull << from);
+  if (!mask)
+    return -1;
+
+  // Compiles to RBIT and CLZ
+  return (int8_t)__builtin_ctzll(mask);
+}
+
+/*! @brief Finds the next tick on which a timer expires or a slot is moved down.
+ *
+ *  @param delta The address to store the number of ticks from now.
+ *  @return bool - TRUE if any timer is running.
+ *  @note Must be called in a critical section.
+ */
+static bool NextEvent(uint32_t* const delta)
+{
+  uint8_t shift, index;
+  int8_t next;
+  uint64_t blockMask;
+
+  for (uint8_t level = 0; level < TIMERWHEEL_NB_LEVELS; level++)
+  {
+    shift = level * TIMERWHEEL_SLOT_BITS;
+    index = (uint8_t)((Now >> shift) & TIMERWHEEL_SLOT_MASK);
+    next = NextOccupied(level, index + 1);
+
+    // Lower levels come before the next slot of a higher level is moved down
+    if (next >= 0)
+    {
+      blockMask = (1ull << (shift + TIMERWHEEL_SLOT_BITS)) - 1;
+      *delta = (uint32_t)(((uint64_t)Now & ~blockMask) | ((uint64_t)next << shift)) - Now;
+      return true;
+    }
+  }
+
+  // Only the top level holds timers past the point where the tick count wraps
+  next = NextOccupied(TIMERWHEEL_NB_LEVELS - 1, 0);
+  if (next >= 0)
+  {
+    *delta = ((uint32_t)next << ((TIMERWHEEL_NB_LEVELS - 1) * TIMERWHEEL_SLOT_BITS)) - Now;
+    return true;
+  }
+
+  return false;
+}
+#endif
+
+/*! @brief Advances the wheel by one tick and expires the timers in the new slot.
+ */
+static void Step(void)
+{
+  TTimerWheelTimer** slot;
+  TTimerWheelTimer* timer;
+  void (*userFunction)(void*);
+  void* userArguments;
+
+  EnterCritical();
+  Now++;
+
+  // Move down the next slot of each level whose lower bits have rolled over
+  for (uint8_t level = 1; (level < TIMERWHEEL_NB_LEVELS) && !(Now & ((1u << (level * TIMERWHEEL_SLOT_BITS)) - 1)); level++)
+    Cascade(level, (uint8_t)((Now >> (level * TIMERWHEEL_SLOT_BITS)) & TIMERWHEEL_SLOT_MASK));
+
+  slot = &Slots[0][Now & TIMERWHEEL_SLOT_MASK];
+  ExitCritical();
+
+  // Every timer in this slot expires now - take them one at a time so that callbacks can use the wheel
+  for (;;)
+  {
+    EnterCritical();
+    timer = *slot;
+    if (!timer)
+    {
+      ExitCritical();
+      break;
+    }
+
+    Remove(timer);
+    userFunction = timer->userFunction;
+    userArguments = timer->userArguments;
+    if (timer->period)
+    {
+      timer->expiry = Now + timer->period;
+      Insert(timer);
+    }
+    else
+      Free(timer);
+    ExitCritical();
+
+    userFunction(userArguments);
+  }
+}
+
+#ifdef TIMERWHEEL_TICKLESS
+/*! @brief Gets the tick count from the lifetime timer.
+ */
+static uint64_t Elapsed(void)
+{
+  return (PIT_LifetimeNanoseconds() - StartTime) / TickPeriod;
+}
+
+/*! @brief Advances the wheel to a tick, skipping the ticks on which nothing happens.
+ */
+static void Advance(const uint32_t target)
+{
+  uint32_t delta;
+
+  EnterCritical();
+  Advancing = true;
+  while (NextEvent(&delta) && (delta <= target - Now))
+  {
+    Now += delta - 1;
+    ExitCritical();
+    Step();
+    EnterCritical();
+  }
+  Now = target;
+  Advancing = false;
+  ExitCritical();
+}
+
+/*! @brief Moves the wheel up to the lifetime timer without expiring any timers.
+ *
+ *  Now only moves on in the interrupt, and not at all while no timer is running,
+ *  so it is caught up before a timer is inserted. It stops just short of a tick on which anything happens,
+ *  which is left for the interrupt.
+ *  @return uint32_t - the tick count from the lifetime timer.
+ *  @note Must be called in a critical section.
+ */
+static uint32_t CatchUp(void)
+{
+  uint32_t elapsed = (uint32_t)Elapsed();
+  uint32_t delta;
+
+  if (!Advancing)
+  {
+    if (NextEvent(&delta) && (delta <= elapsed - Now))
+      Now += delta - 1;
+    else
+      Now = elapsed;
+  }
+
+  return elapsed;
+}
+
+/*! @brief Programs the PIT channel for the next tick on which anything happens, or stops it if no timer is running.
+ */
+static void Rearm(void)
+{
+  uint32_t delta;
+  uint64_t time, elapsed, sleep = TIMERWHEEL_MIN_SLEEP;
+  int32_t ahead;
+
+  EnterCritical();
+  if (!NextEvent(&delta))
+  {
+    (void)PIT_Enable(Channel, false);
+    ExitCritical();
+    return;
+  }
+
+  time = PIT_LifetimeNanoseconds() - StartTime;
+  elapsed = time / TickPeriod;
+
+  // The wheel can be behind the lifetime timer, so measure the deadline from the current time
+  ahead = (int32_t)(Now + delta - (uint32_t)elapsed);
+  if (ahead > 0)
+  {
+    sleep = (elapsed + (uint32_t)ahead) * TickPeriod - time;
+    if (sleep < TIMERWHEEL_MIN_SLEEP)
+      sleep = TIMERWHEEL_MIN_SLEEP;
+    else if (sleep > TIMERWHEEL_MAX_SLEEP)
+      sleep = TIMERWHEEL_MAX_SLEEP;
+  }
+
+  (void)PIT_Set(Channel, (uint32_t)sleep, true);
+  ExitCritical();
+}
+#endif
+
+/*! @brief Advances the wheel from the PIT channel.
+ */
+static void TickCallback(void* arguments)
+{
+  TimerWheel_Tick();
+}
+
+bool TimerWheel_Init(const uint8_t channelNb, const uint32_t tickPeriod)
+{
+  EnterCritical();
+  Now = 0;
+  FreeTimers = NULL;
+  for (uint16_t index = TIMERWHEEL_NB_TIMERS; index > 0; index--)
+  {
+    Timers[index - 1].link = NULL;
+    Free(&Timers[index - 1]);
+  }
+  for (uint8_t level = 0; level < TIMERWHEEL_NB_LEVELS; level++)
+  {
+    Occupied[level] = 0;
+    for (uint8_t slot = 0; slot < TIMERWHEEL_NB_SLOTS; slot++)
+      Slots[level][slot] = NULL;
+  }
+  ExitCritical();
+
+#ifdef TIMERWHEEL_TICKLESS
+  if (tickPeriod == 0)
+    return false;
+
+  Channel = channelNb;
+  TickPeriod = tickPeriod;
+  StartTime = PIT_LifetimeNanoseconds();
+
+  // The channel only runs while a timer is running
+  return PIT_SetCallback(channelNb, TickCallback, NULL) && PIT_Enable(channelNb, false);
+#else
+  return PIT_SetCallback(channelNb, TickCallback, NULL) && PIT_Set(channelNb, tickPeriod, true);
+#endif
+}
+
+TTimerWheelHandle TimerWheel_Start(const uint32_t delay, const uint32_t period, void (*userFunction)(void*), void* userArguments)
+{
+  TTimerWheelTimer* timer;
+  TTimerWheelHandle handle;
+
+  if ((delay == 0) || (delay > TIMERWHEEL_MAX_DELAY) || (period > TIMERWHEEL_MAX_DELAY) || !userFunction)
+    return TIMERWHEEL_INVALID_HANDLE;
+
+  EnterCritical();
+  timer = FreeTimers;
+  if (!timer)
+  {
+    ExitCritical();
+    return TIMERWHEEL_INVALID_HANDLE;
+  }
+  FreeTimers = timer->next;
+
+  // Generation 0 is skipped so that no handle is ever TIMERWHEEL_INVALID_HANDLE
+  if (++timer->generation == 0)
+    timer->generation = 1;
+
+#ifdef TIMERWHEEL_TICKLESS
+  // Count from the lifetime timer, which Now can still be behind if a timer is due
+  timer->expiry = CatchUp() + delay;
+#else
+  timer->expiry = Now + delay;
+#endif
+  timer->period = period;
+  timer->userFunction = userFunction;
+  timer->userArguments = userArguments;
+  Insert(timer);
+
+  handle = ((uint32_t)timer->generation << 16) | (uint32_t)(timer - Timers);
+
+#ifdef TIMERWHEEL_TICKLESS
+  Rearm();
+#endif
+  ExitCritical();
+
+  return handle;
+}
+
+bool TimerWheel_Cancel(const TTimerWheelHandle handle)
+{
+  TTimerWheelTimer* timer;
+  bool running = false;
+
+  EnterCritical();
+  timer = Lookup(handle);
+  if (timer && timer->link)
+  {
+    Remove(timer);
+    Free(timer);
+    running = true;
+  }
+  ExitCritical();
+
+  return running;
+}
+
+uint32_t TimerWheel_Now(void)
+{
+#ifdef TIMERWHEEL_TICKLESS
+  uint32_t now;
+
+  EnterCritical();
+  (void)CatchUp();
+  now = Now;
+  ExitCritical();
+
+  return now;
+#else
+  return Now;
+#endif
+}
+
+void TimerWheel_Tick(void)
+{
+#ifdef TIMERWHEEL_TICKLESS
+  Advance((uint32_t)Elapsed());
+  Rearm();
+#else
+  Step();
+#endif
+}
+
+#ifdef TIMERWHEEL_TICKLESS
+void TimerWheel_Sleep(void)
+{
+  SMC_PreEnterWaitModes();
+  (void)SMC_SetPowerModeWait(SMC);
+  SMC_PostExitWaitModes();
+}
+#endif
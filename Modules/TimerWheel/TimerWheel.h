@@ -0,0 +1,91 @@
+/*! @file
+ *
+ *  @brief Routines for software timers multiplexed on one PIT channel.
+ *
+ *  This contains the functions for a hierarchical timer wheel driven by a periodic PIT tick.
+ *  Timers come from a fixed pool, and starting, cancelling and expiring a timer take constant time,
+ *  so protocol timeouts, LED patterns, debouncing and retransmission can each have their own deadline.
+ *  Callbacks run from the PIT interrupt.
+ *  Defining TIMERWHEEL_TICKLESS programs the PIT channel for the next deadline only, instead of every tick,
+ *  so the CPU can stay in Wait mode until a timer is due.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+// new types
+#include "Types\types.h"
+
+// Number of timers in the pool
+#ifndef TIMERWHEEL_NB_TIMERS
+#define TIMERWHEEL_NB_TIMERS 32
+#endif
+
+// Longest delay or period in ticks
+#define TIMERWHEEL_MAX_DELAY 0x3FFFFFFFu
+
+// A handle that never refers to a timer
+#define TIMERWHEEL_INVALID_HANDLE 0
+
+/*! A timer handle - stays unique after the timer expires or is cancelled, so a stale handle is harmless */
+typedef uint32_t TTimerWheelHandle;
+
+/*! @brief Sets up the timer wheel before first use.
+ *
+ *  All timers are freed, and a PIT channel is started to drive the wheel.
+ *  In tickless mode the channel only runs while a timer is running.
+ *  @param channelNb The PIT channel to use.
+ *  @param tickPeriod The tick period in nanoseconds.
+ *  @return bool - TRUE if the timer wheel was successfully initialized.
+ *  @note Assumes that PIT_Init has been called, and in tickless mode that PIT_LifetimeInit has also been called.
+ */
+bool TimerWheel_Init(const uint8_t channelNb, const uint32_t tickPeriod);
+
+/*! @brief Starts a timer from the pool.
+ *
+ *  @param delay The number of ticks until the timer expires (1 to TIMERWHEEL_MAX_DELAY).
+ *  @param period The number of ticks between later expiries, or 0 for a one-shot timer.
+ *  @param userFunction is a pointer to the user callback function called when the timer expires.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return TTimerWheelHandle - the timer, or TIMERWHEEL_INVALID_HANDLE if the pool is empty or a parameter is invalid.
+ *  @note Assumes that TimerWheel_Init has been called.
+ */
+TTimerWheelHandle TimerWheel_Start(const uint32_t delay, const uint32_t period, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Cancels a timer and returns it to the pool.
+ *
+ *  @param handle The timer.
+ *  @return bool - TRUE if the timer was running, FALSE if it had already expired or been cancelled.
+ */
+bool TimerWheel_Cancel(const TTimerWheelHandle handle);
+
+/*! @brief Gets the number of ticks since TimerWheel_Init.
+ *
+ *  In tickless mode the count is caught up with the lifetime timer, except that it stops short of a tick
+ *  whose timers the interrupt has not yet expired, so it can lag while the interrupt is pending or masked.
+ *  In a callback it is the tick the timer was due on.
+ *  @return uint32_t - the tick count, which wraps.
+ */
+uint32_t TimerWheel_Now(void);
+
+/*! @brief Advances the wheel by one tick and calls the callbacks of timers that expire.
+ *
+ *  Called from the PIT interrupt. Timers that have moved down to the lowest level are expired one at a time,
+ *  so a callback may start or cancel timers.
+ *  In tickless mode the wheel instead catches up with the lifetime timer, and the channel is programmed for the next deadline.
+ *  @note Assumes that TimerWheel_Init has been called.
+ */
+void TimerWheel_Tick(void);
+
+#ifdef TIMERWHEEL_TICKLESS
+/*! @brief Sleeps in Wait mode until the next interrupt.
+ *
+ *  Peripherals keep running, and the PIT channel wakes the CPU when the next timer is due.
+ */
+void TimerWheel_Sleep(void);
+#endif
+
+#endif
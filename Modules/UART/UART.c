@@ -0,0 +1,161 @@
+/*! @file
+ *
+ *  @brief I/O routines for UART communications on the FRDM-K64F.
+ *
+ *  This contains the functions for operating the UART (serial port).
+ *  UART0 is connected to the OpenSDA virtual serial port on PTB16 (RX) and PTB17 (TX).
+ *
+ *  @author PMcL
+ *  @date 2015-07-23
+ */
+
+#include <stddef.h>
+
+#include "UART\UART.h"
+#include "FIFO\FIFO.h"
+#include "MK64F12.h"
+
+// Pin mux alternative for UART0 on PTB16/PTB17
+#define UART_PIN_MUX 3
+
+// Valid range of the 13-bit baud rate modulo divisor
+#define UART_SBR_MIN 1u
+#define UART_SBR_MAX 0x1FFFu
+
+static TFIFO RxFIFO;
+static TFIFO TxFIFO;
+
+/*! @brief Calculates the baud rate divisor.
+ *
+ *  baud rate = moduleClk / (16 x (SBR + BRFA / 32)), so the divisor in 1/32 units is 2 x moduleClk / baud rate.
+ *  @param moduleClk The module clock rate in Hz.
+ *  @param baudRate The desired baud rate in bits/sec.
+ *  @param sbr The address of a variable to store the baud rate modulo divisor.
+ *  @param brfa The address of a variable to store the baud rate fine adjust.
+ *  @param actualBaudRate The address of a variable to store the generated baud rate, or NULL.
+ *  @return bool - TRUE if the generated baud rate is within tolerance.
+ */
+static bool CalculateDivisor(const uint32_t moduleClk, const uint32_t baudRate, uint16_t* const sbr, uint8_t* const brfa, uint32_t* const actualBaudRate)
+{
+  uint64_t divisor;
+  uint32_t actual, error;
+
+  if (baudRate == 0)
+    return false;
+
+  // Round to the nearest 1/32 of a divisor step
+  divisor = ((uint64_t)moduleClk * 2u + baudRate / 2u) / baudRate;
+  if ((divisor >> 5) < UART_SBR_MIN || (divisor >> 5) > UART_SBR_MAX)
+    return false;
+
+  actual = (uint32_t)(((uint64_t)moduleClk * 2u) / divisor);
+  error = (actual > baudRate) ? (actual - baudRate) : (baudRate - actual);
+  if ((uint64_t)error * 100u > (uint64_t)baudRate * UART_BAUD_TOLERANCE_PERCENT)
+    return false;
+
+  *sbr = (uint16_t)(divisor >> 5);
+  *brfa = (uint8_t)(divisor & 0x1Fu);
+  if (actualBaudRate)
+    *actualBaudRate = actual;
+
+  return true;
+}
+
+/*! @brief Writes a baud rate divisor to the UART.
+ *
+ *  @param sbr The baud rate modulo divisor.
+ *  @param brfa The baud rate fine adjust.
+ *  @note The new divisor only takes effect once BDL is written, so BDH must be written first.
+ */
+static void WriteDivisor(const uint16_t sbr, const uint8_t brfa)
+{
+  uint16union_t sbrUnion;
+
+  sbrUnion.l = sbr;
+  UART0->BDH = (UART0->BDH & ~UART_BDH_SBR_MASK) | UART_BDH_SBR(sbrUnion.s.Hi);
+  UART0->BDL = sbrUnion.s.Lo;
+  UART0->C4 = (UART0->C4 & ~UART_C4_BRFA_MASK) | UART_C4_BRFA(brfa);
+}
+
+bool UART_Init(const uint32_t moduleClk, const uint32_t baudRate)
+{
+  uint16_t sbr;
+  uint8_t brfa;
+
+  if (!CalculateDivisor(moduleClk, baudRate, &sbr, &brfa, NULL))
+    return false;
+
+  // Enable clock gates to UART0 and port B
+  SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
+  SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
+
+  PORTB->PCR[16] = PORT_PCR_MUX(UART_PIN_MUX);
+  PORTB->PCR[17] = PORT_PCR_MUX(UART_PIN_MUX);
+
+  // Transmitter and receiver must be disabled while the format is set
+  UART0->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK);
+
+  // 8 data bits, no parity, 1 stop bit
+  UART0->C1 = 0;
+  WriteDivisor(sbr, brfa);
+
+  UART0->C2 |= UART_C2_TE_MASK | UART_C2_RE_MASK;
+
+  return FIFO_Init(&RxFIFO) && FIFO_Init(&TxFIFO);
+}
+
+bool UART_CheckBaudRate(const uint32_t moduleClk, const uint32_t baudRate, uint32_t* const actualBaudRate)
+{
+  uint16_t sbr;
+  uint8_t brfa;
+
+  return CalculateDivisor(moduleClk, baudRate, &sbr, &brfa, actualBaudRate);
+}
+
+bool UART_SetBaudRate(const uint32_t moduleClk, const uint32_t baudRate)
+{
+  uint16_t sbr;
+  uint8_t brfa;
+  uint8_t enables;
+
+  if (!CalculateDivisor(moduleClk, baudRate, &sbr, &brfa, NULL))
+    return false;
+
+  enables = UART0->C2 & (UART_C2_TE_MASK | UART_C2_RE_MASK);
+  UART0->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK);
+  WriteDivisor(sbr, brfa);
+  UART0->C2 |= enables;
+
+  return true;
+}
+
+bool UART_InChar(uint8_t* const dataPtr)
+{
+  return FIFO_Get(&RxFIFO, dataPtr);
+}
+
+bool UART_OutChar(const uint8_t data)
+{
+  return FIFO_Put(&TxFIFO, data);
+}
+
+bool UART_TxComplete(void)
+{
+  return (TxFIFO.NbBytes == 0) && (UART0->S1 & UART_S1_TC_MASK);
+}
+
+void UART_Poll(void)
+{
+  uint8_t data;
+
+  // Reading S1 followed by D clears RDRF
+  if (UART0->S1 & UART_S1_RDRF_MASK)
+    (void)FIFO_Put(&RxFIFO, UART0->D);
+
+  // Reading S1 followed by writing D clears TDRE
+  if (UART0->S1 & UART_S1_TDRE_MASK)
+  {
+    if (FIFO_Get(&TxFIFO, &data))
+      UART0->D = data;
+  }
+}
@@ -14,6 +14,9 @@
 // new types
 #include "Types\types.h"
 
+// Maximum error, in percent, between a requested and a generated baud rate
+#define UART_BAUD_TOLERANCE_PERCENT 2
+
 /*! @brief Sets up the UART interface before first use.
  *
  *  @param moduleClk The module clock rate in Hz.
@@ -21,6 +24,34 @@
  *  @return bool - TRUE if the UART was successfully initialized.
  */
 bool UART_Init(const uint32_t moduleClk, const uint32_t baudRate);
+
+/*! @brief Checks whether a baud rate can be generated from the module clock.
+ *
+ *  Uses the same SBR/BRFA calculation as UART_Init.
+ *  @param moduleClk The module clock rate in Hz.
+ *  @param baudRate The desired baud rate in bits/sec.
+ *  @param actualBaudRate The address of a variable to store the generated baud rate, or NULL.
+ *  @return bool - TRUE if the generated baud rate is within UART_BAUD_TOLERANCE_PERCENT of the desired baud rate.
+ */
+bool UART_CheckBaudRate(const uint32_t moduleClk, const uint32_t baudRate, uint32_t* const actualBaudRate);
+
+/*! @brief Changes the baud rate of the UART.
+ *
+ *  The transmitter and receiver are disabled while the divisor is updated,
+ *  so any character in progress is lost.
+ *  @param moduleClk The module clock rate in Hz.
+ *  @param baudRate The desired baud rate in bits/sec.
+ *  @return bool - TRUE if the baud rate was achievable and has been set.
+ *  @note Assumes that UART_Init has been called.
+ */
+bool UART_SetBaudRate(const uint32_t moduleClk, const uint32_t baudRate);
+
+/*! @brief Checks whether all data has been transmitted.
+ *
+ *  @return bool - TRUE if the transmit FIFO is empty and the last stop bit has left the shift register.
+ *  @note Assumes that UART_Init has been called.
+ */
+bool UART_TxComplete(void);
  
 /*! @brief Get a character from the receive FIFO if it is not empty.
  *
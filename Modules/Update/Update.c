@@ -0,0 +1,323 @@
+/*! @file
+ *
+ *  @brief Routines for updating the firmware over the serial protocol.
+ *
+ *  The image is streamed 3 bytes per UPDATE_CMD_DATA packet, so the host pads it with 0xFF to a multiple of 3
+ *  and computes the CRC over the padded image.
+ *  The data area is copied phrase by phrase, skipping blank phrases so that they can still be programmed after the swap.
+ *  Copying the data area and the Swap Control commands write block 0, so the Flash module masks all interrupts
+ *  for each of those commands - a sector erase holds them off for tens of milliseconds.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "Update\Update.h"
+#include "Flash\Flash.h"
+#include "KVStore\KVStore.h"
+#include "Packet\packet.h"
+#include "UART\UART.h"
+#include "MK64F12.h"
+
+#if (FLASH_DATA_START < UPDATE_INACTIVE_START + UPDATE_DATA_OFFSET) \
+ || (FLASH_DATA_END >= UPDATE_INACTIVE_START + UPDATE_DATA_OFFSET + UPDATE_DATA_SIZE)
+#error "The Flash data region must be in the data area of block 1"
+#endif
+
+#if (KVSTORE_START < UPDATE_INACTIVE_START + UPDATE_DATA_OFFSET) \
+ || (KVSTORE_START + KVSTORE_NB_SECTORS * FLASH_SECTOR_SIZE > UPDATE_INACTIVE_START + UPDATE_DATA_OFFSET + UPDATE_DATA_SIZE)
+#error "The KVStore sectors must be in the data area of block 1"
+#endif
+
+// CRC-32 generator polynomial
+#define UPDATE_CRC_POLYNOMIAL 0x04C11DB7LU
+
+// CRC module transpose setting for reflected data - bits in bytes and bytes are transposed
+#define UPDATE_CRC_TRANSPOSE 2
+
+#define ERASED_WORD   0xFFFFFFFFLU
+#define ERASED_PHRASE 0xFFFFFFFFFFFFFFFFLLU
+
+// State of the update in progress
+static bool Receiving;
+static bool Verified;
+static uint32_t MaxSize;
+static uint32_t Received;
+static uint32_t ProgramAddress;  // Flash address of the first byte in Buffer
+
+// Received data not yet programmed
+static uint8_t Buffer[FLASH_SECTOR_SIZE];
+static uint16_t NbBuffered;
+
+// Low half of the expected CRC from UPDATE_OP_CRC_LOW
+static uint16_t CRCLow;
+
+/*! @brief Checks whether a sector is completely erased.
+ */
+static bool SectorErased(const uint32_t address)
+{
+  for (uint32_t offset = 0; offset < FLASH_SECTOR_SIZE; offset += 4)
+  {
+    if (_FW(address + offset) != ERASED_WORD)
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Erases the sectors in a range that are not already erased.
+ *
+ *  @param address The start of the range, on a sector boundary.
+ *  @param size The size of the range in bytes.
+ */
+static bool EraseRange(const uint32_t address, const uint32_t size)
+{
+  for (uint32_t offset = 0; offset < size; offset += FLASH_SECTOR_SIZE)
+  {
+    if (!SectorErased(address + offset) && !Flash_EraseSector(address + offset))
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Programs the buffered data.
+ *
+ *  @param pad TRUE to pad the data with 0xFF to a whole Program Section unit.
+ */
+static bool Flush(const bool pad)
+{
+  uint16_t size = NbBuffered;
+
+  if (pad)
+  {
+    while (size % FLASH_SECTION_ALIGNMENT)
+      Buffer[size++] = 0xFF;
+  }
+
+  if (size == 0)
+    return true;
+
+  if (!Flash_WriteSection(ProgramAddress, Buffer, size))
+    return false;
+
+  ProgramAddress += size;
+  NbBuffered = 0;
+  return true;
+}
+
+/*! @brief Calculates the CRC-32 of a block of Flash using the CRC module.
+ *
+ *  @param address The start of the block.
+ *  @param length The number of bytes.
+ */
+static uint32_t FlashCRC(const uint32_t address, const uint32_t length)
+{
+  uint32_t offset;
+
+  // 32-bit CRC with reflected input and output and a final XOR - write the seed with WAS set
+  CRC0->CTRL = CRC_CTRL_TCRC_MASK | CRC_CTRL_TOT(UPDATE_CRC_TRANSPOSE) | CRC_CTRL_TOTR(UPDATE_CRC_TRANSPOSE)
+             | CRC_CTRL_FXOR_MASK | CRC_CTRL_WAS_MASK;
+  CRC0->GPOLY = UPDATE_CRC_POLYNOMIAL;
+  CRC0->DATA = ERASED_WORD;
+  CRC0->CTRL &= ~CRC_CTRL_WAS_MASK;
+
+  for (offset = 0; offset + 4 <= length; offset += 4)
+    CRC0->DATA = _FW(address + offset);
+
+  for (; offset < length; offset++)
+    CRC0->ACCESS8BIT.DATALL = _FB(address + offset);
+
+  return CRC0->DATA;
+}
+
+/*! @brief Copies the data area of block 1 to block 0, so that it is back at the same addresses after the swap.
+ */
+static bool CopyDataArea(void)
+{
+  uint32_t source = UPDATE_INACTIVE_START + UPDATE_DATA_OFFSET;
+  uint32_t destination = UPDATE_DATA_OFFSET;
+  uint64_t phrase;
+
+  if (!EraseRange(destination, UPDATE_DATA_SIZE))
+    return false;
+
+  for (uint32_t offset = 0; offset < UPDATE_DATA_SIZE; offset += FLASH_PHRASE_SIZE)
+  {
+    phrase = _FP(source + offset);
+    if ((phrase != ERASED_PHRASE) && !Flash_ProgramPhrase(destination + offset, phrase))
+      return false;
+  }
+
+  return true;
+}
+
+bool Update_Init(void)
+{
+  SIM->SCGC6 |= SIM_SCGC6_CRC_MASK;
+
+  Receiving = false;
+  Verified = false;
+  NbBuffered = 0;
+
+  return Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_REPORT, NULL);
+}
+
+bool Update_Start(const uint32_t size)
+{
+  TFlashSwapMode mode;
+
+  Receiving = false;
+  Verified = false;
+
+  if ((size == 0) || (size > UPDATE_MAX_IMAGE_SIZE))
+    return false;
+
+  if (!Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_REPORT, &mode))
+    return false;
+
+  // The first update initializes the swap system, later ones start from the Ready state
+  if (mode == FLASH_SWAP_UNINITIALIZED)
+  {
+    if (!Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_INIT, &mode))
+      return false;
+  }
+  else if (mode == FLASH_SWAP_READY)
+  {
+    if (!Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_SET_UPDATE, &mode))
+      return false;
+  }
+
+  // Erasing the inactive block's swap indicator allows the inactive block to be programmed
+  if (mode == FLASH_SWAP_UPDATE)
+  {
+    if (!Flash_EraseSector(UPDATE_INACTIVE_START + UPDATE_SWAP_INDICATOR)
+        || !Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_REPORT, &mode))
+      return false;
+  }
+
+  // A swap armed by an earlier update is still waiting for a reset
+  if (mode != FLASH_SWAP_UPDATE_ERASED)
+    return false;
+
+  if (!EraseRange(UPDATE_INACTIVE_START, ((size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE))
+    return false;
+
+  MaxSize = size;
+  Received = 0;
+  ProgramAddress = UPDATE_INACTIVE_START;
+  NbBuffered = 0;
+  Receiving = true;
+
+  return true;
+}
+
+bool Update_Write(const uint8_t* const data, const uint32_t length)
+{
+  if (!Receiving || (Received + length > MaxSize))
+    return false;
+
+  for (uint32_t i = 0; i < length; i++)
+  {
+    Buffer[NbBuffered++] = data[i];
+
+    // A full buffer is one sector, programmed with a single Program Section command
+    if ((NbBuffered == sizeof(Buffer)) && !Flush(false))
+    {
+      Receiving = false;
+      return false;
+    }
+  }
+
+  Received += length;
+  return true;
+}
+
+bool Update_Verify(const uint32_t crc)
+{
+  if (!Receiving || (Received == 0))
+    return false;
+
+  Receiving = false;
+  if (!Flush(true))
+    return false;
+
+  Verified = (FlashCRC(UPDATE_INACTIVE_START, Received) == crc);
+  return Verified;
+}
+
+bool Update_Swap(void)
+{
+  TFlashSwapMode mode;
+
+  if (!Verified)
+    return false;
+
+  // Make sure the latest non-volatile variables are in the data area before it is copied
+  if (!Flash_Commit() || !CopyDataArea())
+    return false;
+
+  if (!Flash_SwapControl(UPDATE_SWAP_INDICATOR, FLASH_SWAP_SET_COMPLETE, &mode))
+    return false;
+
+  Verified = false;
+  return (mode == FLASH_SWAP_COMPLETE);
+}
+
+bool Update_HandlePacket(void)
+{
+  uint8_t data[3];
+  bool success = false;
+  bool reset = false;
+
+  switch (Packet_Command & ~PACKET_ACK_MASK)
+  {
+    case UPDATE_CMD_DATA:
+      data[0] = Packet_Parameter1;
+      data[1] = Packet_Parameter2;
+      data[2] = Packet_Parameter3;
+      success = Update_Write(data, sizeof(data));
+      break;
+
+    case UPDATE_CMD_CONTROL:
+      switch (Packet_Parameter1)
+      {
+        case UPDATE_OP_START:
+          success = Update_Start((uint32_t)Packet_Parameter23 * 1024);
+          break;
+        case UPDATE_OP_CRC_LOW:
+          CRCLow = Packet_Parameter23;
+          success = Receiving;
+          break;
+        case UPDATE_OP_VERIFY:
+          success = Update_Verify(((uint32_t)Packet_Parameter23 << 16) | CRCLow);
+          break;
+        case UPDATE_OP_SWAP:
+          success = Update_Swap();
+          reset = success;
+          break;
+        default:
+          break;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if (Packet_Command & PACKET_ACK_MASK)
+    (void)Packet_Put(success ? Packet_Command : (Packet_Command & ~PACKET_ACK_MASK),
+                     Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+
+  // The new firmware starts after the reset - the downtime is just the reset itself
+  if (reset)
+  {
+    while (!UART_TxComplete())
+      UART_Poll();
+    NVIC_SystemReset();
+  }
+
+  return success;
+}
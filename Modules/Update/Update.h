@@ -0,0 +1,99 @@
+/*! @file
+ *
+ *  @brief Routines for updating the firmware over the serial protocol.
+ *
+ *  This contains the functions for an A/B update using the program flash swap feature.
+ *  Each 512 KB program flash block holds a firmware image at its start and a reserved area at its top.
+ *  The firmware always runs from block 0's addresses; the new image is written to the inactive block at
+ *  UPDATE_INACTIVE_START, checked against a CRC-32 computed by the CRC module, and the blocks are swapped by the next reset.
+ *  Images must be linked to fit below UPDATE_MAX_IMAGE_SIZE, which leaves the data area (used by the Flash and
+ *  KVStore modules) and the swap indicator sector free.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef UPDATE_H
+#define UPDATE_H
+
+// new types
+#include "Types\types.h"
+
+// Size of each program flash block
+#define UPDATE_BANK_SIZE 0x00080000LU
+// Address of the inactive block, where the new image is written
+#define UPDATE_INACTIVE_START UPDATE_BANK_SIZE
+
+// Offset of the reserved area at the top of each block
+#define UPDATE_RESERVED_OFFSET 0x00070000LU
+// Largest firmware image in bytes
+#define UPDATE_MAX_IMAGE_SIZE UPDATE_RESERVED_OFFSET
+// Offset and size of the data area, which is carried across to the other block before a swap
+#define UPDATE_DATA_OFFSET UPDATE_RESERVED_OFFSET
+#define UPDATE_DATA_SIZE   0x0000F000LU
+// Address of the swap indicator, in the last sector of block 0
+#define UPDATE_SWAP_INDICATOR 0x0007F000LU
+
+// Update commands
+#define UPDATE_CMD_CONTROL 0x10
+#define UPDATE_CMD_DATA    0x11
+
+// Update control operations, in parameter 1 of UPDATE_CMD_CONTROL
+#define UPDATE_OP_START    0x00  // Parameters 2 and 3 - image size in KB, little-endian
+#define UPDATE_OP_CRC_LOW  0x01  // Parameters 2 and 3 - bits 0 to 15 of the image CRC-32
+#define UPDATE_OP_VERIFY   0x02  // Parameters 2 and 3 - bits 16 to 31 of the image CRC-32
+#define UPDATE_OP_SWAP     0x03  // Swaps blocks and resets
+
+/*! @brief Sets up the CRC module and reports the swap state.
+ *
+ *  @return bool - TRUE if the update module was successfully initialized.
+ *  @note Assumes Flash has been initialized.
+ */
+bool Update_Init(void);
+
+/*! @brief Prepares the inactive block for a new image.
+ *
+ *  Moves the swap system to the Update-Erased state and erases enough of the inactive block for the image.
+ *  @param size The largest image size in bytes - the image itself may be shorter.
+ *  @return bool - TRUE if the inactive block is ready to program.
+ *  @note Assumes that Update_Init has been called.
+ */
+bool Update_Start(const uint32_t size);
+
+/*! @brief Appends data to the new image.
+ *
+ *  Data is collected in RAM and programmed a sector at a time with Program Section commands.
+ *  @param data A pointer to the data.
+ *  @param length The number of bytes.
+ *  @return bool - TRUE if the data was accepted, FALSE if no update is in progress, the image is too long or programming failed.
+ *  @note Assumes that Update_Start has been called.
+ */
+bool Update_Write(const uint8_t* const data, const uint32_t length);
+
+/*! @brief Programs any remaining data and checks the whole image.
+ *
+ *  @param crc The expected CRC-32 (as used by Ethernet and zlib) of the image.
+ *  @return bool - TRUE if every byte was received and the image matches the CRC.
+ *  @note Assumes that Update_Start has been called.
+ */
+bool Update_Verify(const uint32_t crc);
+
+/*! @brief Copies the data area to the active block and arranges for the blocks to swap at the next reset.
+ *
+ *  @return bool - TRUE if the swap is armed, FALSE if there is no verified image or a Flash command failed.
+ *  @note The caller should reset soon afterwards, since data written before the reset is not carried across.
+ */
+bool Update_Swap(void);
+
+/*! @brief Handles an update packet.
+ *
+ *  The reply has the acknowledgement bit set on success and cleared on failure, and is only sent if an acknowledgement was requested.
+ *  Programming a sector stalls the serial port for tens of milliseconds, so hosts should request an acknowledgement
+ *  for each data packet and wait for it.
+ *  A successful UPDATE_OP_SWAP resets the processor once the reply has been sent.
+ *  @return bool - TRUE if the packet was an update command and succeeded.
+ *  @note Assumes that Packet_Get has returned an UPDATE_CMD_CONTROL or UPDATE_CMD_DATA packet.
+ */
+bool Update_HandlePacket(void);
+
+#endif
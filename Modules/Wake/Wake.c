@@ -0,0 +1,273 @@
+/*! @file
+ *
+ *  @brief Routines for sleeping in the low-leakage stop modes until scheduled jobs are due.
+ *
+ *  The RTC alarm flag is a module wake-up source of the LLWU, and the LLWU flag follows it,
+ *  so cancelling the alarm in the LLWU interrupt acknowledges the wake-up.
+ *  The alarm goes off as the seconds counter reaches the alarm time, when the prescaler is at zero,
+ *  so the prescaler read once the clocks are restored is the wake-up latency.
+ *  In LLS the MCG stops and the processor wakes in PBE mode, so the PLL is relocked and selected before the jobs run.
+ *  The RTC domain is not reset by a wake-up from VLLS, so the alarm register still holds the alarm that caused it.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stddef.h>
+
+#include "Wake\Wake.h"
+#include "Critical\critical.h"
+#include "RTC\RTC.h"
+#include "MK64F12.h"
+#include "fsl_clock.h"
+#include "fsl_smc.h"
+
+/*!
+ * @struct TWakeJob
+ */
+typedef struct TWakeJob
+{
+  struct TWakeJob* next;          /*!< The next job due, or the next job in the free list */
+  uint32_t seconds;               /*!< The second the job is due */
+  void (*userFunction)(void*);    /*!< The user callback function */
+  void* userArguments;            /*!< The user arguments */
+} TWakeJob;
+
+static TWakeJob Jobs[WAKE_NB_JOBS];
+static TWakeJob* FreeJobs;
+
+// Scheduled jobs in order of the second they are due
+static TWakeJob* Head;
+
+// The second the alarm is set for
+static uint32_t AlarmSeconds;
+
+static volatile bool Alarmed;
+static bool FromVLLS;
+
+static TWakeLatency Latency;
+
+/*! @brief Gets the current second from the RTC.
+ */
+static uint32_t Now(void)
+{
+  TRTCTimestamp timestamp;
+
+  RTC_GetTimestamp(&timestamp);
+  return timestamp.seconds;
+}
+
+/*! @brief Checks whether the first job is due.
+ */
+static bool Due(void)
+{
+  return Head && ((int32_t)(Head->seconds - Now()) <= 0);
+}
+
+/*! @brief Sets the alarm for the first job, or cancels it if there are none.
+ *
+ *  If the first job is already due, the alarm is left cancelled.
+ */
+static void Arm(void)
+{
+  EnterCritical();
+  if (Head)
+  {
+    AlarmSeconds = Head->seconds;
+    (void)RTC_SetAlarm(AlarmSeconds, NULL, NULL);
+  }
+  else
+    (void)RTC_SetAlarm(0, NULL, NULL);
+  ExitCritical();
+}
+
+/*! @brief Records the latency from an alarm to now.
+ *
+ *  @param alarmSeconds The second the alarm went off.
+ */
+static void Record(const uint32_t alarmSeconds)
+{
+  TRTCTimestamp timestamp;
+  uint32_t ticks, latency;
+
+  RTC_GetTimestamp(&timestamp);
+  ticks = (timestamp.seconds - alarmSeconds) * RTC_SUBSECONDS_PER_SECOND + timestamp.subseconds;
+  latency = (uint32_t)(((uint64_t)ticks * 1000000u) / RTC_SUBSECONDS_PER_SECOND);
+
+  Latency.last = latency;
+  if (latency > Latency.max)
+    Latency.max = latency;
+  Latency.count++;
+}
+
+/*! @brief Selects the PLL again after LLS.
+ *
+ *  The PLL is off in LLS, so the MCG comes back in PBE mode.
+ */
+static void RestoreClocks(void)
+{
+  if (CLOCK_GetMode() == kMCG_ModePBE)
+  {
+    while (!(MCG->S & MCG_S_LOCK0_MASK))
+      ;
+    (void)CLOCK_SetPeeMode();
+  }
+}
+
+bool Wake_Init(void)
+{
+  // Protection can only be written once after reset
+  SMC_SetPowerModeProtection(SMC, kSMC_AllowPowerModeLls | kSMC_AllowPowerModeVlls);
+
+  FreeJobs = NULL;
+  for (uint8_t i = 0; i < WAKE_NB_JOBS; i++)
+  {
+    Jobs[i].next = FreeJobs;
+    FreeJobs = &Jobs[i];
+  }
+  Head = NULL;
+  Alarmed = false;
+
+  FromVLLS = (RCM->SRS0 & RCM_SRS0_WAKEUP_MASK) != 0;
+  if (FromVLLS)
+  {
+    // The alarm register holds the second before the alarm
+    if (RTC->SR & RTC_SR_TAF_MASK)
+      Record(RTC->TAR + 1);
+
+    // The pins hold their state through VLLS until released
+    if (PMC->REGSC & PMC_REGSC_ACKISO_MASK)
+      PMC->REGSC |= PMC_REGSC_ACKISO_MASK;
+  }
+  (void)RTC_SetAlarm(0, NULL, NULL);
+
+  LLWU->ME |= LLWU_ME_WUME5_MASK;
+  NVIC_SetPriority(LLWU_IRQn, CRITICAL_PRIORITY_DEFAULT);
+  NVIC_ClearPendingIRQ(LLWU_IRQn);
+  NVIC_EnableIRQ(LLWU_IRQn);
+
+  return true;
+}
+
+bool Wake_FromVLLS(void)
+{
+  return FromVLLS;
+}
+
+bool Wake_Schedule(const uint32_t seconds, void (*userFunction)(void*), void* userArguments)
+{
+  TWakeJob* job;
+  TWakeJob** link;
+
+  if (!userFunction)
+    return false;
+
+  EnterCritical();
+  job = FreeJobs;
+  if (!job)
+  {
+    ExitCritical();
+    return false;
+  }
+  FreeJobs = job->next;
+
+  job->seconds = seconds;
+  job->userFunction = userFunction;
+  job->userArguments = userArguments;
+
+  // Jobs due in the same second run in the order they were scheduled
+  link = &Head;
+  while (*link && ((int32_t)((*link)->seconds - seconds) <= 0))
+    link = &(*link)->next;
+  job->next = *link;
+  *link = job;
+  ExitCritical();
+
+  Arm();
+  return true;
+}
+
+void Wake_Run(void)
+{
+  TWakeJob* job;
+  void (*userFunction)(void*);
+  void* userArguments;
+
+  for (;;)
+  {
+    EnterCritical();
+    if (!Due())
+    {
+      ExitCritical();
+      break;
+    }
+    job = Head;
+    Head = job->next;
+    userFunction = job->userFunction;
+    userArguments = job->userArguments;
+    job->next = FreeJobs;
+    FreeJobs = job;
+    ExitCritical();
+
+    userFunction(userArguments);
+  }
+
+  Arm();
+}
+
+bool Wake_Sleep(const TWakeMode mode)
+{
+  smc_power_mode_vlls_config_t config;
+  status_t status;
+
+  if (!Head)
+    return false;
+
+  SMC_PreEnterStopModes();
+
+  // With interrupts masked, an alarm from here on stays pending and wakes the processor
+  if (Due())
+  {
+    SMC_PostExitStopModes();
+    return true;
+  }
+  Alarmed = false;
+
+  if (mode == WAKE_MODE_LLS)
+    status = SMC_SetPowerModeLls(SMC);
+  else
+  {
+    config.subMode = kSMC_StopSub1;
+    config.enablePorDetectInVlls0 = true;
+    status = SMC_SetPowerModeVlls(SMC, &config);
+  }
+
+  // The LLWU interrupt runs here
+  SMC_PostExitStopModes();
+
+  // LLS is aborted by an interrupt that is already pending, which wakes the processor just the same
+  if ((mode != WAKE_MODE_LLS) && (status != kStatus_Success))
+    return false;
+
+  RestoreClocks();
+  if (Alarmed)
+    Record(AlarmSeconds);
+
+  return true;
+}
+
+void Wake_GetLatency(TWakeLatency* const latency)
+{
+  EnterCritical();
+  *latency = Latency;
+  ExitCritical();
+}
+
+void __attribute__ ((interrupt)) LLWU_IRQHandler(void)
+{
+  if (LLWU->F3 & LLWU_F3_MWUF5_MASK)
+  {
+    Alarmed = true;
+    (void)RTC_SetAlarm(0, NULL, NULL);
+  }
+}
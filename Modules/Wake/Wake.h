@@ -0,0 +1,101 @@
+/*! @file
+ *
+ *  @brief Routines for sleeping in the low-leakage stop modes until scheduled jobs are due.
+ *
+ *  This contains the functions for a wake scheduler driven by the RTC alarm.
+ *  Jobs are kept in order of the second they are due, and the alarm is set for the earliest,
+ *  so the processor can spend the time between jobs in LLS or VLLS1 with only the RTC running.
+ *  The LLWU turns the alarm into a wake-up from either mode.
+ *  LLS keeps the RAM and resumes after Wake_Sleep. VLLS1 powers the RAM down and wakes through a reset,
+ *  so the jobs must be scheduled again from start-up - the RTC keeps time throughout.
+ *  The time from the alarm to the processor being ready to run jobs is measured on each wake-up.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef WAKE_H
+#define WAKE_H
+
+// new types
+#include "Types\types.h"
+
+// Number of jobs in the pool
+#ifndef WAKE_NB_JOBS
+#define WAKE_NB_JOBS 16
+#endif
+
+typedef enum
+{
+  WAKE_MODE_LLS,
+  WAKE_MODE_VLLS
+} TWakeMode;
+
+/*!
+ * @struct TWakeLatency
+ */
+typedef struct
+{
+  uint32_t last;     /*!< Latency of the last wake-up by the alarm in microseconds */
+  uint32_t max;      /*!< Longest latency in microseconds */
+  uint32_t count;    /*!< Number of wake-ups by the alarm measured */
+} TWakeLatency;
+
+/*! @brief Sets up the wake scheduler before first use.
+ *
+ *  Allows the low-leakage stop modes, and makes the RTC alarm a wake-up source.
+ *  After a wake-up from VLLS, releases the pins from isolation and measures the wake-up latency.
+ *  @return bool - TRUE if the wake scheduler was successfully initialized.
+ *  @note Assumes that RTC_Init has been called, and that the pins have been set up, since they return to software control.
+ *  Must be called once after reset, since the stop modes can only be allowed once.
+ */
+bool Wake_Init(void);
+
+/*! @brief Checks whether the processor has just woken up from VLLS.
+ *
+ *  @return bool - TRUE if the last reset was a wake-up from VLLS, so the jobs need to be scheduled again.
+ */
+bool Wake_FromVLLS(void);
+
+/*! @brief Schedules a job from the pool.
+ *
+ *  @param seconds The number of seconds since 1970-01-01 00:00:00 UTC when the job is due.
+ *  @param userFunction is a pointer to the user callback function called when the job is run.
+ *  @param userArguments is a pointer to the user arguments to use with the user callback function.
+ *  @return bool - TRUE if the job was scheduled, FALSE if the pool is empty.
+ *  @note Assumes that Wake_Init has been called.
+ */
+bool Wake_Schedule(const uint32_t seconds, void (*userFunction)(void*), void* userArguments);
+
+/*! @brief Runs the jobs that are due and sets the alarm for the next.
+ *
+ *  Called from the main loop, so a job may take as long as it needs and may schedule further jobs.
+ *  @note Assumes that Wake_Init has been called.
+ */
+void Wake_Run(void);
+
+/*! @brief Sleeps in a low-leakage stop mode until the next job is due.
+ *
+ *  In LLS, returns once woken with the PLL running again. In VLLS, only returns if the mode could not be entered.
+ *  @param mode The stop mode to enter.
+ *  @return bool - TRUE if the processor slept or a job is already due, FALSE if no job is scheduled or the mode could not be entered.
+ *  @note Assumes that Wake_Init has been called.
+ */
+bool Wake_Sleep(const TWakeMode mode);
+
+/*! @brief Gets the latency from the alarm to the processor being ready to run jobs.
+ *
+ *  Measured in RTC prescaler ticks, so the resolution is 30.5 us.
+ *  After a wake-up from VLLS, the measurement includes the start-up code up to Wake_Init.
+ *  @param latency The address to store the latency statistics.
+ */
+void Wake_GetLatency(TWakeLatency* const latency);
+
+/*! @brief Interrupt service routine for the LLWU.
+ *
+ *  Cancels the alarm that woke the processor, which clears the wake-up flag.
+ *  @note Assumes that Wake_Init has been called.
+ */
+void __attribute__ ((interrupt)) LLWU_IRQHandler(void);
+
+#endif
@@ -13,15 +13,137 @@
 */
 /* MODULE main */
 
-// TODO: Upgrade to Lab 3 functionality (copy Lab 2 main and use that as a starting point).
+#include "clock_config.h"
+#include "pin_mux.h"
+#include "system_MK64F12.h"
+
+#include "Critical\critical.h"
+#include "Flash\Flash.h"
+#include "FMC\FMC.h"
+#include "Packet\packet.h"
+#include "UART\UART.h"
+#include "Update\Update.h"
+
+#ifdef ENCODER_STREAM
+#include "fsl_clock.h"
+#include "Encoder\Encoder.h"
+#include "PIT\PIT.h"
+#endif
+
+// Baud rate used at start-up, so legacy hosts can always connect
+#define BAUD_RATE 115200
+
+#ifdef FMC_BENCHMARK
+// Runs the FMC cache and prefetch benchmark and writes the results over SWO
+#define CMD_FMC_BENCHMARK 0x12
+#endif
+
+#ifdef FLASH_BENCHMARK
+// Runs the Flash phrase and section programming benchmark and writes the results over SWO
+#define CMD_FLASH_BENCHMARK 0x15
+#endif
+
+#ifdef ENCODER_STREAM
+// Encoder 0 is sampled every millisecond on PIT channel 2, leaving channels 0 and 1 for the lifetime timer
+#define ENCODER_PIT_CHANNEL   2
+#define ENCODER_SAMPLE_PERIOD 1000000
+#define ENCODER_FILTER        4
+#endif
+
+/*! @brief Handles a packet received from the PC.
+ *
+ *  Unrecognised commands are NAKed if an acknowledgment was requested.
+ */
+static void HandlePacket(void)
+{
+  switch (Packet_Command & ~PACKET_ACK_MASK)
+  {
+    case PACKET_CMD_BAUD_RATE:
+      // Replies itself so that the switch happens after the reply
+      (void)Packet_HandleBaudRate();
+      break;
+
+    case UPDATE_CMD_CONTROL:
+    case UPDATE_CMD_DATA:
+      (void)Update_HandlePacket();
+      break;
+
+#ifdef CRITICAL_PROFILE
+    case CRITICAL_CMD_PROFILE:
+      Critical_ProfileDump();
+      if (Packet_Parameter1)
+        Critical_ProfileReset();
+      if (Packet_Command & PACKET_ACK_MASK)
+        (void)Packet_Put(Packet_Command, Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+      break;
+#endif
+
+#ifdef ENCODER_STREAM
+    case ENCODER_CMD_STREAM:
+      (void)Encoder_HandlePacket();
+      break;
+#endif
+
+#ifdef FMC_BENCHMARK
+    case CMD_FMC_BENCHMARK:
+      FMC_Benchmark(NULL);
+      if (Packet_Command & PACKET_ACK_MASK)
+        (void)Packet_Put(Packet_Command, Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+      break;
+#endif
+
+#ifdef FLASH_BENCHMARK
+    case CMD_FLASH_BENCHMARK:
+      // Parameter 1 is 1 if the benchmark succeeded
+      Packet_Parameter1 = Flash_Benchmark(NULL);
+      if (Packet_Command & PACKET_ACK_MASK)
+        (void)Packet_Put(Packet_Command, Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+      break;
+#endif
+
+    default:
+      if (Packet_Command & PACKET_ACK_MASK)
+        (void)Packet_Put(Packet_Command & ~PACKET_ACK_MASK, Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+      break;
+  }
+}
 
 /*!
  * @brief Main function
  */
 int main(void)
 {
+  BOARD_InitBootPins();
+  BOARD_InitBootClocks();
+
+#ifdef CRITICAL_PROFILE
+  Critical_ProfileInit();
+#endif
+
+  if (!Flash_Init() || !Update_Init())
+    DEBUG_HALT();
+
+  // UART0 is clocked from the system clock
+  if (!Packet_Init(SystemCoreClock, BAUD_RATE))
+    DEBUG_HALT();
+
+#ifdef ENCODER_STREAM
+  // The PIT is clocked from the bus clock
+  if (!PIT_Init(CLOCK_GetBusClkFreq()) || !Encoder_Init(0, ENCODER_FILTER)
+      || !Encoder_SampleInit(ENCODER_PIT_CHANNEL, ENCODER_SAMPLE_PERIOD))
+    DEBUG_HALT();
+#endif
+
   for (;;)
   {
+    UART_Poll();
+
+    if (Packet_Get())
+      HandlePacket();
+
+#ifdef ENCODER_STREAM
+    Encoder_Poll();
+#endif
   }
 }
 
@@ -0,0 +1,187 @@
+/*! @file
+ *
+ *  @brief Tests of the atomic operations, using the host fallback.
+ *
+ *  Each operation is checked at 8, 16 and 32 bits, including wrap-around and a failed compare-exchange.
+ *  Threads then race on shared counters, so a lost update in FetchAdd or CompareExchange shows up as a wrong total.
+ *
+ *  @author agent
+ *  @date 2026-10-19
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Atomic\atomic.h"
+
+// Threads racing on each counter
+#define TEST_NB_THREADS 4
+
+// Updates made by each thread
+#define TEST_NB_UPDATES 200000u
+
+static uint32_t NbChecks;
+static uint32_t NbFailures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// Counters shared by the racing threads
+static volatile uint32_t AddCounter;
+static volatile uint32_t CASCounter;
+static volatile uint8_t Lock;
+static uint32_t LockedCounter;
+
+/*! @brief Records the result of a check, printing it if it failed.
+ */
+static void Check(const bool passed, const char* const text, const int line)
+{
+  NbChecks++;
+  if (!passed)
+  {
+    NbFailures++;
+    printf("FAIL line %d: %s\n", line, text);
+  }
+}
+
+/*! @brief Checks the 8-bit operations.
+ */
+static void Test8(void)
+{
+  volatile uint8_t value = 0xFE;
+  uint8_t expected;
+
+  CHECK(Atomic_FetchAdd8(&value, 1) == 0xFE);
+  CHECK(Atomic_FetchAdd8(&value, 3) == 0xFF);
+  CHECK(value == 0x02);
+
+  CHECK(Atomic_Exchange8(&value, 0xA5) == 0x02);
+  CHECK(value == 0xA5);
+
+  expected = 0xA5;
+  CHECK(Atomic_CompareExchange8(&value, &expected, 0x5A));
+  CHECK((value == 0x5A) && (expected == 0xA5));
+  expected = 0xA5;
+  CHECK(!Atomic_CompareExchange8(&value, &expected, 0x00));
+  CHECK((value == 0x5A) && (expected == 0x5A));
+}
+
+/*! @brief Checks the 16-bit operations.
+ */
+static void Test16(void)
+{
+  volatile uint16_t value = 0xFFFE;
+  uint16_t expected;
+
+  CHECK(Atomic_FetchAdd16(&value, 1) == 0xFFFE);
+  CHECK(Atomic_FetchAdd16(&value, 0x0102) == 0xFFFF);
+  CHECK(value == 0x0101);
+
+  CHECK(Atomic_Exchange16(&value, 0xBEEF) == 0x0101);
+  CHECK(value == 0xBEEF);
+
+  expected = 0xBEEF;
+  CHECK(Atomic_CompareExchange16(&value, &expected, 0x1234));
+  CHECK((value == 0x1234) && (expected == 0xBEEF));
+  expected = 0xBEEF;
+  CHECK(!Atomic_CompareExchange16(&value, &expected, 0x0000));
+  CHECK((value == 0x1234) && (expected == 0x1234));
+}
+
+/*! @brief Checks the 32-bit operations.
+ */
+static void Test32(void)
+{
+  volatile uint32_t value = 0xFFFFFFFEu;
+  uint32_t expected;
+
+  CHECK(Atomic_FetchAdd32(&value, 1) == 0xFFFFFFFEu);
+  CHECK(Atomic_FetchAdd32(&value, 0x10000) == 0xFFFFFFFFu);
+  CHECK(value == 0x0000FFFFu);
+
+  // Adding the two's complement subtracts
+  CHECK(Atomic_FetchAdd32(&value, (uint32_t)-0xFFFF) == 0x0000FFFFu);
+  CHECK(value == 0);
+
+  CHECK(Atomic_Exchange32(&value, 0xDEADBEEFu) == 0);
+  CHECK(value == 0xDEADBEEFu);
+
+  expected = 0xDEADBEEFu;
+  CHECK(Atomic_CompareExchange32(&value, &expected, 0x01234567u));
+  CHECK((value == 0x01234567u) && (expected == 0xDEADBEEFu));
+  expected = 0xDEADBEEFu;
+  CHECK(!Atomic_CompareExchange32(&value, &expected, 0));
+  CHECK((value == 0x01234567u) && (expected == 0x01234567u));
+}
+
+/*! @brief Checks the test-and-set flag.
+ */
+static void TestFlag(void)
+{
+  volatile uint8_t flag = 0;
+
+  CHECK(!Atomic_TestAndSet(&flag));
+  CHECK(flag != 0);
+  CHECK(Atomic_TestAndSet(&flag));
+  Atomic_Clear(&flag);
+  CHECK(flag == 0);
+  CHECK(!Atomic_TestAndSet(&flag));
+}
+
+/*! @brief Updates the shared counters with each kind of operation.
+ */
+static void* Race(void* arguments)
+{
+  uint32_t expected;
+
+  for (uint32_t i = 0; i < TEST_NB_UPDATES; i++)
+  {
+    (void)Atomic_FetchAdd32(&AddCounter, 1);
+
+    expected = CASCounter;
+    while (!Atomic_CompareExchange32(&CASCounter, &expected, expected + 1))
+      ;
+
+    while (Atomic_TestAndSet(&Lock))
+      ;
+    LockedCounter++;
+    Atomic_Clear(&Lock);
+  }
+
+  return NULL;
+}
+
+/*! @brief Checks that no update is lost when threads race.
+ */
+static void TestRace(void)
+{
+  pthread_t threads[TEST_NB_THREADS];
+
+  for (uint8_t i = 0; i < TEST_NB_THREADS; i++)
+    CHECK(pthread_create(&threads[i], NULL, Race, NULL) == 0);
+  for (uint8_t i = 0; i < TEST_NB_THREADS; i++)
+    CHECK(pthread_join(threads[i], NULL) == 0);
+
+  CHECK(AddCounter == TEST_NB_THREADS * TEST_NB_UPDATES);
+  CHECK(CASCounter == TEST_NB_THREADS * TEST_NB_UPDATES);
+  CHECK(LockedCounter == TEST_NB_THREADS * TEST_NB_UPDATES);
+}
+
+int main(void)
+{
+  Test8();
+  Test16();
+  Test32();
+  TestFlag();
+  TestRace();
+
+  printf("%lu checks, %lu failures\n", (unsigned long)NbChecks, (unsigned long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
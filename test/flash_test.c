@@ -0,0 +1,153 @@
+/*! @file
+ *
+ *  @brief Tests of committing the Flash RAM shadow on the Flash simulator.
+ *
+ *  Built with a data region of two sectors, to check that Flash_WriteBlock only commits the sectors it touches,
+ *  and that commits fall back to phrase programming when the FlexRAM is not available as RAM.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Flash\Flash.h"
+#include "FlashSim\FlashSim.h"
+
+#if FLASH_DATA_SIZE != 2 * FLASH_SECTOR_SIZE
+#error "Build with FLASH_DATA_SIZE set to two sectors"
+#endif
+
+// A word in the second sector of the data region
+#define TEST_WORD_ADDRESS (FLASH_DATA_START + FLASH_SECTOR_SIZE + 64)
+
+// Size of the blocks written to the first sector
+#define TEST_BLOCK_SIZE 64
+
+static uint32_t NbChecks;
+static uint32_t NbFailures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+/*! @brief Records the result of a check, printing it if it failed.
+ */
+static void Check(const bool passed, const char* const text, const int line)
+{
+  NbChecks++;
+  if (!passed)
+  {
+    NbFailures++;
+    printf("FAIL line %d: %s\n", line, text);
+  }
+}
+
+/*! @brief Fills in a test block.
+ */
+static void MakeBlock(uint8_t* const block, const uint8_t seed)
+{
+  for (uint16_t i = 0; i < TEST_BLOCK_SIZE; i++)
+    block[i] = (uint8_t)(seed + i * 7);
+}
+
+/*! @brief Checks whether Flash holds a block.
+ */
+static bool InFlash(const uint32_t address, const uint8_t* const block)
+{
+  return memcmp(FlashSim_Address(address), block, TEST_BLOCK_SIZE) == 0;
+}
+
+/*! @brief Starts from erased Flash and an empty shadow.
+ */
+static void Fresh(void)
+{
+  FlashSim_Init();
+  CHECK(Flash_Init());
+}
+
+static void TestWriteBlockSectors(void)
+{
+  uint8_t block[TEST_BLOCK_SIZE];
+  uint32_t erases;
+
+  Fresh();
+
+  // A change in the second sector is left for Flash_Commit
+  CHECK(Flash_Write32((volatile uint32_t*)TEST_WORD_ADDRESS, 0x12345678u));
+  MakeBlock(block, 1);
+  CHECK(Flash_WriteBlock((volatile void*)FLASH_DATA_START, block, sizeof(block)));
+  CHECK(InFlash(FLASH_DATA_START, block));
+  CHECK(_FW(TEST_WORD_ADDRESS) == 0xFFFFFFFFu);
+  CHECK(Flash_IsDirty());
+
+  CHECK(Flash_Commit());
+  CHECK(_FW(TEST_WORD_ADDRESS) == 0x12345678u);
+  CHECK(!Flash_IsDirty());
+
+  // Rewriting the block erases its own sector only
+  erases = FlashSim_EraseCount(TEST_WORD_ADDRESS);
+  MakeBlock(block, 2);
+  CHECK(Flash_WriteBlock((volatile void*)FLASH_DATA_START, block, sizeof(block)));
+  CHECK(InFlash(FLASH_DATA_START, block));
+  CHECK(FlashSim_EraseCount(FLASH_DATA_START) == 1);
+  CHECK(FlashSim_EraseCount(TEST_WORD_ADDRESS) == erases);
+  CHECK(_FW(TEST_WORD_ADDRESS) == 0x12345678u);
+
+  // A block across the sector boundary commits both sectors
+  MakeBlock(block, 3);
+  CHECK(Flash_WriteBlock((volatile void*)(FLASH_DATA_START + FLASH_SECTOR_SIZE - TEST_BLOCK_SIZE / 2), block, sizeof(block)));
+  CHECK(InFlash(FLASH_DATA_START + FLASH_SECTOR_SIZE - TEST_BLOCK_SIZE / 2, block));
+  CHECK(!Flash_IsDirty());
+
+  // Out of the data region
+  CHECK(!Flash_WriteBlock((volatile void*)(FLASH_DATA_END - 1), block, sizeof(block)));
+}
+
+static void TestNoFlexRAM(void)
+{
+  uint8_t block[TEST_BLOCK_SIZE];
+  TFlashSimStats before, after;
+
+  Fresh();
+  FlashSim_SetFlexRAM(false);
+  CHECK(!Flash_WriteSection(FLASH_DATA_START, block, sizeof(block)));
+
+  // Blank phrases, then phrases that need an erase
+  for (uint8_t seed = 1; seed <= 2; seed++)
+  {
+    MakeBlock(block, seed);
+    FlashSim_GetStats(&before);
+    CHECK(Flash_WriteBlock((volatile void*)FLASH_DATA_START, block, sizeof(block)));
+    FlashSim_GetStats(&after);
+    CHECK(InFlash(FLASH_DATA_START, block));
+    CHECK(after.nbErrors == before.nbErrors);
+    CHECK(after.nbPhrases - before.nbPhrases == TEST_BLOCK_SIZE / FLASH_PHRASE_SIZE);
+  }
+
+  CHECK(Flash_Write32((volatile uint32_t*)TEST_WORD_ADDRESS, 0xCAFEF00Du));
+  CHECK(Flash_Commit());
+  CHECK(_FW(TEST_WORD_ADDRESS) == 0xCAFEF00Du);
+
+  // The shadow reloads from what was programmed
+  CHECK(Flash_Init());
+  CHECK(_FW(TEST_WORD_ADDRESS) == 0xCAFEF00Du);
+  CHECK(InFlash(FLASH_DATA_START, block));
+  FlashSim_SetFlexRAM(true);
+}
+
+int main(void)
+{
+  TestWriteBlockSectors();
+  TestNoFlexRAM();
+
+  printf("%lu checks, %lu failures\n", (unsigned long)NbChecks, (unsigned long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/*! @file
+ *
+ *  @brief Wear and endurance run of the key-value store on the Flash simulator.
+ *
+ *  Keys are updated round-robin until a write fails because a sector has worn out,
+ *  then the erase count of each sector and the simulator statistics are printed.
+ *  Even wear shows up as equal erase counts across the store's sectors,
+ *  and the number of updates gives the lifetime of the store at FLASH_SIM_ENDURANCE erases per sector.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Flash\Flash.h"
+#include "FlashSim\FlashSim.h"
+#include "KVStore\KVStore.h"
+
+// Keys updated in turn, and the size of each value
+#define ENDURANCE_NB_KEYS   8
+#define ENDURANCE_VALUE_SIZE 8
+
+// Progress is printed every this many updates
+#define ENDURANCE_REPORT 1000000u
+
+int main(void)
+{
+  uint8_t value[ENDURANCE_VALUE_SIZE] = {0};
+  uint32_t nbUpdates = 0;
+  TFlashSimStats stats;
+
+  FlashSim_Init();
+  if (!Flash_Init() || !KVStore_Init())
+  {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  for (;;)
+  {
+    // A different value each time, so every update is a new record
+    value[0] = (uint8_t)nbUpdates;
+    value[1] = (uint8_t)(nbUpdates >> 8);
+    value[2] = (uint8_t)(nbUpdates >> 16);
+    value[3] = (uint8_t)(nbUpdates >> 24);
+
+    if (!KVStore_Write((uint16_t)(nbUpdates % ENDURANCE_NB_KEYS), value, sizeof(value)))
+      break;
+    nbUpdates++;
+
+    if (nbUpdates % ENDURANCE_REPORT == 0)
+      printf("%lu updates, max erase count %lu\n", (unsigned long)nbUpdates, (unsigned long)FlashSim_MaxEraseCount());
+  }
+
+  FlashSim_GetStats(&stats);
+
+  printf("updates before wear-out: %lu\n", (unsigned long)nbUpdates);
+  printf("erase counts:");
+  for (uint8_t sector = 0; sector < KVSTORE_NB_SECTORS; sector++)
+    printf(" %lu", (unsigned long)FlashSim_EraseCount(KVSTORE_START + sector * FLASH_SECTOR_SIZE));
+  printf("\n");
+  printf("updates per erase: %.1f\n", stats.nbErases ? (double)nbUpdates / stats.nbErases : 0.0);
+  printf("commands %lu, errors %lu, erases %lu, phrases %lu, over-programs %lu\n",
+         (unsigned long)stats.nbCommands, (unsigned long)stats.nbErrors, (unsigned long)stats.nbErases,
+         (unsigned long)stats.nbPhrases, (unsigned long)stats.nbOverPrograms);
+  printf("busy time %.1f s, %.1f us per update\n",
+         stats.busyTime / 1e6, nbUpdates ? (double)stats.busyTime / nbUpdates : 0.0);
+
+  // Wear-out must come from the endurance limit, with no phrase ever programmed twice
+  if ((FlashSim_MaxEraseCount() <= FLASH_SIM_ENDURANCE) || stats.nbOverPrograms)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
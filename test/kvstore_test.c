@@ -0,0 +1,507 @@
+/*! @file
+ *
+ *  @brief Tests of the key-value store on the Flash simulator.
+ *
+ *  Covers writing, reading and deleting keys, erase rotation across the sectors, garbage collection into the spare,
+ *  rebuilding the index after a reset, and recovery when power is lost part way through any Flash command.
+ *  A reset is simulated by running Flash_Init and KVStore_Init again on the same image.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Flash\Flash.h"
+#include "FlashSim\FlashSim.h"
+#include "KVStore\KVStore.h"
+
+// Keys used by the model-based tests
+#define TEST_NB_KEYS 10
+
+// Operations run after each power loss point
+#define TEST_NB_OPERATIONS 400
+
+/*!
+ * @struct TTestKey
+ *  What the store should hold for a key.
+ */
+typedef struct
+{
+  bool present;       /*!< TRUE if the key is stored */
+  uint8_t length;     /*!< The value length */
+  uint32_t version;   /*!< Selects the value bytes */
+} TTestKey;
+
+static uint32_t NbChecks;
+static uint32_t NbFailures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+/*! @brief Records the result of a check, printing it if it failed.
+ */
+static void Check(const bool passed, const char* const text, const int line)
+{
+  NbChecks++;
+  if (!passed)
+  {
+    NbFailures++;
+    printf("FAIL line %d: %s\n", line, text);
+  }
+}
+
+/*! @brief Fills in the value bytes of a version of a key.
+ *
+ *  The first two bytes hold the version, so different versions of a value of 2 bytes or more never match.
+ */
+static void MakeValue(uint8_t* const value, const uint16_t key, const uint32_t version, const uint8_t length)
+{
+  for (uint8_t i = 0; i < length; i++)
+  {
+    if (i < 2)
+      value[i] = (uint8_t)(version >> (8 * i));
+    else
+      value[i] = (uint8_t)(key * 31u + i);
+  }
+}
+
+/*! @brief Chooses a value length for a version of a key, so records span one to several phrases.
+ */
+static uint8_t MakeLength(const uint16_t key, const uint32_t version)
+{
+  return (uint8_t)(2u + (key * 5u + version * 3u) % 28u);
+}
+
+/*! @brief Checks that the store holds what the model says for a key.
+ */
+static bool Matches(const uint16_t key, const TTestKey* const model)
+{
+  uint8_t expected[KVSTORE_MAX_VALUE_SIZE];
+  uint8_t value[KVSTORE_MAX_VALUE_SIZE];
+  uint8_t length;
+
+  if (!KVStore_Read(key, value, sizeof(value), &length))
+    return !model->present;
+
+  MakeValue(expected, key, model->version, model->length);
+  return model->present && (length == model->length) && (memcmp(value, expected, length) == 0);
+}
+
+/*! @brief Sets the model of a key to a version of its value.
+ */
+static void SetVersion(TTestKey* const model, const uint16_t key, const uint32_t version)
+{
+  model->present = true;
+  model->length = MakeLength(key, version);
+  model->version = version;
+}
+
+/*! @brief Writes the value the model holds for a key.
+ */
+static bool WriteModel(const uint16_t key, const TTestKey* const model)
+{
+  uint8_t value[KVSTORE_MAX_VALUE_SIZE];
+
+  MakeValue(value, key, model->version, model->length);
+  return KVStore_Write(key, value, model->length);
+}
+
+/*! @brief Writes a version of a key and updates the model if it succeeds.
+ */
+static bool WriteVersion(const uint16_t key, const uint32_t version, TTestKey* const model)
+{
+  TTestKey written;
+
+  SetVersion(&written, key, version);
+  if (!WriteModel(key, &written))
+    return false;
+
+  *model = written;
+  return true;
+}
+
+/*! @brief Starts with a blank simulator and an empty store.
+ */
+static void Fresh(void)
+{
+  FlashSim_Init();
+  CHECK(Flash_Init());
+  CHECK(KVStore_Init());
+}
+
+/*! @brief Simulates a reset with power restored.
+ */
+static void Reboot(void)
+{
+  FlashSim_PowerOn();
+  CHECK(Flash_Init());
+  CHECK(KVStore_Init());
+}
+
+/*! @brief Checks whether a sector of the store is completely erased.
+ */
+static bool SectorErased(const uint8_t sector)
+{
+  uint32_t start = KVSTORE_START + sector * FLASH_SECTOR_SIZE;
+
+  for (uint32_t address = start; address < start + FLASH_SECTOR_SIZE; address += 4)
+  {
+    if (_FW(address) != 0xFFFFFFFFLU)
+      return false;
+  }
+
+  return true;
+}
+
+/*! @brief Counts the erased sectors of the store.
+ */
+static uint8_t NbErasedSectors(void)
+{
+  uint8_t count = 0;
+
+  for (uint8_t sector = 0; sector < KVSTORE_NB_SECTORS; sector++)
+    count += SectorErased(sector) ? 1 : 0;
+
+  return count;
+}
+
+/*! @brief Writes, reads and deletes keys, and checks the argument limits.
+ */
+static void TestBasic(void)
+{
+  uint8_t big[KVSTORE_MAX_VALUE_SIZE + 1];
+  uint8_t value[KVSTORE_MAX_VALUE_SIZE];
+  uint8_t length = 0;
+  TFlashSimStats before, after;
+
+  Fresh();
+  memset(big, 0x5A, sizeof(big));
+
+  CHECK(!KVStore_Read(1, value, sizeof(value), &length));
+  CHECK(KVStore_Write(1, "abc", 3));
+  CHECK(KVStore_Read(1, value, sizeof(value), &length) && (length == 3) && (memcmp(value, "abc", 3) == 0));
+
+  CHECK(KVStore_Write(1, "0123456789", 10));
+  CHECK(KVStore_Read(1, value, sizeof(value), &length) && (length == 10) && (memcmp(value, "0123456789", 10) == 0));
+
+  // A short buffer gets the start of the value and the full length
+  memset(value, 0, sizeof(value));
+  CHECK(KVStore_Read(1, value, 4, &length) && (length == 10) && (memcmp(value, "0123", 4) == 0) && (value[4] == 0));
+
+  CHECK(KVStore_Write(2, big, 0));
+  CHECK(KVStore_Read(2, value, sizeof(value), &length) && (length == 0));
+
+  CHECK(KVStore_Write(3, big, KVSTORE_MAX_VALUE_SIZE));
+  CHECK(KVStore_Read(3, value, sizeof(value), &length) && (length == KVSTORE_MAX_VALUE_SIZE) && (memcmp(value, big, length) == 0));
+  CHECK(!KVStore_Write(3, big, KVSTORE_MAX_VALUE_SIZE + 1));
+  CHECK(!KVStore_Write(KVSTORE_KEY_COMMIT, big, 1));
+  CHECK(!KVStore_Delete(KVSTORE_KEY_COMMIT));
+
+  // Writing the value already stored costs no Flash command
+  FlashSim_GetStats(&before);
+  CHECK(KVStore_Write(3, big, KVSTORE_MAX_VALUE_SIZE));
+  FlashSim_GetStats(&after);
+  CHECK(after.nbCommands == before.nbCommands);
+
+  CHECK(KVStore_Delete(1));
+  CHECK(!KVStore_Read(1, value, sizeof(value), &length));
+  CHECK(KVStore_Delete(1));
+  CHECK(KVStore_Read(2, value, sizeof(value), &length) && (length == 0));
+
+  // The index holds KVSTORE_MAX_KEYS keys
+  for (uint16_t key = 10; key < 10 + KVSTORE_MAX_KEYS - 2; key++)
+    CHECK(KVStore_Write(key, &key, sizeof(key)));
+  CHECK(!KVStore_Write(1000, "x", 1));
+  CHECK(KVStore_Delete(10));
+  CHECK(KVStore_Write(1000, "x", 1));
+
+  // An aborted transaction leaves nothing behind, a committed one applies every update
+  CHECK(KVStore_Begin());
+  CHECK(!KVStore_Begin());
+  CHECK(KVStore_Write(2, "txn", 3));
+  KVStore_Abort();
+  CHECK(KVStore_Read(2, value, sizeof(value), &length) && (length == 0));
+
+  CHECK(KVStore_Begin());
+  CHECK(KVStore_Write(2, "txn", 3));
+  CHECK(KVStore_Delete(3));
+  CHECK(KVStore_Read(3, value, sizeof(value), &length));
+  CHECK(KVStore_Commit());
+  CHECK(KVStore_Read(2, value, sizeof(value), &length) && (length == 3) && (memcmp(value, "txn", 3) == 0));
+  CHECK(!KVStore_Read(3, value, sizeof(value), &length));
+
+  Reboot();
+  CHECK(!KVStore_Read(1, value, sizeof(value), &length));
+  CHECK(KVStore_Read(2, value, sizeof(value), &length) && (length == 3) && (memcmp(value, "txn", 3) == 0));
+  CHECK(!KVStore_Read(3, value, sizeof(value), &length));
+  CHECK(KVStore_Read(1000, value, sizeof(value), &length) && (length == 1) && (value[0] == 'x'));
+}
+
+/*! @brief Rebuilds the index after resets between random writes and deletes.
+ */
+static void TestReboot(void)
+{
+  TTestKey model[TEST_NB_KEYS] = {{0}};
+  uint16_t key;
+
+  Fresh();
+  srand(1);
+
+  for (uint32_t operation = 1; operation <= 3000; operation++)
+  {
+    key = (uint16_t)(rand() % TEST_NB_KEYS);
+    if (rand() % 5 == 0)
+    {
+      CHECK(KVStore_Delete(key));
+      model[key].present = false;
+    }
+    else
+      CHECK(WriteVersion(key, operation, &model[key]));
+
+    if (operation % 97 == 0)
+    {
+      Reboot();
+      for (key = 0; key < TEST_NB_KEYS; key++)
+        CHECK(Matches(key, &model[key]));
+    }
+  }
+}
+
+/*! @brief Checks that erases rotate evenly through the sectors with a spare always kept erased.
+ */
+static void TestWear(void)
+{
+  TTestKey model[TEST_NB_KEYS] = {{0}};
+  uint32_t counts[KVSTORE_NB_SECTORS];
+  uint32_t min, max;
+
+  Fresh();
+  for (uint16_t key = 0; key < TEST_NB_KEYS; key++)
+    CHECK(WriteVersion(key, 0, &model[key]));
+
+  for (uint32_t version = 1; version <= 20000; version++)
+  {
+    CHECK(WriteVersion((uint16_t)(version % TEST_NB_KEYS), version, &model[version % TEST_NB_KEYS]));
+    if (NbErasedSectors() < 1)
+    {
+      CHECK(NbErasedSectors() >= 1);
+      break;
+    }
+  }
+
+  min = max = FlashSim_EraseCount(KVSTORE_START);
+  for (uint8_t sector = 0; sector < KVSTORE_NB_SECTORS; sector++)
+  {
+    counts[sector] = FlashSim_EraseCount(KVSTORE_START + sector * FLASH_SECTOR_SIZE);
+    if (counts[sector] < min)
+      min = counts[sector];
+    if (counts[sector] > max)
+      max = counts[sector];
+  }
+  printf("wear: erase counts %lu %lu %lu %lu\n",
+         (unsigned long)counts[0], (unsigned long)counts[1], (unsigned long)counts[2], (unsigned long)counts[3]);
+  CHECK(min > 10);
+  CHECK(max - min <= 1);
+
+  Reboot();
+  for (uint16_t key = 0; key < TEST_NB_KEYS; key++)
+    CHECK(Matches(key, &model[key]));
+}
+
+/*! @brief Checks that live records are copied out of a sector before it is erased.
+ */
+static void TestCollect(void)
+{
+  TTestKey model[KVSTORE_MAX_KEYS] = {{0}};
+  uint8_t value[KVSTORE_MAX_VALUE_SIZE];
+  uint32_t firstErases;
+  uint32_t version = 0;
+
+  Fresh();
+
+  // Large values that are never rewritten, so they only survive by being collected
+  for (uint16_t key = 1; key < KVSTORE_MAX_KEYS; key++)
+  {
+    MakeValue(value, key, 0, KVSTORE_MAX_VALUE_SIZE);
+    CHECK(KVStore_Write(key, value, KVSTORE_MAX_VALUE_SIZE));
+    model[key].present = true;
+    model[key].length = KVSTORE_MAX_VALUE_SIZE;
+  }
+
+  // Rewrite key 0 until the first sector has been collected twice
+  firstErases = FlashSim_EraseCount(KVSTORE_START);
+  while (FlashSim_EraseCount(KVSTORE_START) < firstErases + 2)
+  {
+    CHECK(WriteVersion(0, ++version, &model[0]));
+    if (version > 10000)
+      break;
+  }
+  CHECK(FlashSim_EraseCount(KVSTORE_START) >= firstErases + 2);
+
+  for (uint16_t key = 0; key < KVSTORE_MAX_KEYS; key++)
+    CHECK(Matches(key, &model[key]));
+
+  Reboot();
+  for (uint16_t key = 0; key < KVSTORE_MAX_KEYS; key++)
+    CHECK(Matches(key, &model[key]));
+  CHECK(NbErasedSectors() >= 1);
+}
+
+/*! @brief Tears a three-phrase record at each of its program commands.
+ */
+static void TestTornRecord(void)
+{
+  TTestKey model[2] = {{0}};
+  TTestKey old;
+  uint8_t value[24];
+
+  for (uint32_t nbCommands = 0; nbCommands <= 3; nbCommands++)
+  {
+    Fresh();
+    CHECK(WriteVersion(0, 1, &model[0]));
+    CHECK(WriteVersion(1, 1, &model[1]));
+    old = model[0];
+
+    // 3 header bytes, 20 value bytes and the CRC byte program three phrases
+    MakeValue(value, 0, 2, 20);
+    FlashSim_PowerFail(nbCommands);
+    if (KVStore_Write(0, value, 20))
+    {
+      model[0].length = 20;
+      model[0].version = 2;
+    }
+    CHECK((nbCommands == 3) == (model[0].version == 2));
+
+    Reboot();
+    CHECK(Matches(0, (nbCommands == 3) ? &model[0] : &old));
+    CHECK(Matches(1, &model[1]));
+
+    // The store carries on after the torn record
+    CHECK(WriteVersion(0, 3, &model[0]));
+    Reboot();
+    CHECK(Matches(0, &model[0]));
+    CHECK(Matches(1, &model[1]));
+  }
+}
+
+/*! @brief Cuts power at every command of a run of writes, deletes, transactions and collections.
+ *
+ *  After the reset, each key must hold either its last value or the one being written when power was lost,
+ *  and the keys of a transaction must all hold either their old or their new values.
+ */
+static void TestPowerLoss(void)
+{
+  TTestKey model[TEST_NB_KEYS];
+  TTestKey next[TEST_NB_KEYS];
+  uint16_t inFlight[3];
+  uint8_t nbInFlight, nbNew;
+  uint32_t nbPoints = 0;
+  bool lost;
+
+  for (uint32_t nbCommands = 0; ; nbCommands++)
+  {
+    Fresh();
+    memset(model, 0, sizeof(model));
+    for (uint16_t key = 0; key < TEST_NB_KEYS; key++)
+      CHECK(WriteVersion(key, 0, &model[key]));
+
+    FlashSim_PowerFail(nbCommands);
+    lost = false;
+    nbInFlight = 0;
+
+    for (uint32_t operation = 1; (operation <= TEST_NB_OPERATIONS) && !lost; operation++)
+    {
+      uint16_t key = (uint16_t)((operation * 7u) % TEST_NB_KEYS);
+
+      memcpy(next, model, sizeof(model));
+      if (operation % 50 == 0)
+      {
+        // A transaction over three keys
+        CHECK(KVStore_Begin());
+        for (uint8_t i = 0; i < 3; i++)
+        {
+          uint16_t txnKey = (uint16_t)((key + i) % TEST_NB_KEYS);
+
+          SetVersion(&next[txnKey], txnKey, operation);
+          CHECK(WriteModel(txnKey, &next[txnKey]));
+          inFlight[i] = txnKey;
+        }
+        nbInFlight = 3;
+        lost = !KVStore_Commit();
+        if (lost)
+          KVStore_Abort();
+      }
+      else if (operation % 11 == 0)
+      {
+        next[key].present = false;
+        inFlight[0] = key;
+        nbInFlight = 1;
+        lost = !KVStore_Delete(key);
+      }
+      else
+      {
+        SetVersion(&next[key], key, operation);
+        inFlight[0] = key;
+        nbInFlight = 1;
+        lost = !WriteModel(key, &next[key]);
+      }
+
+      if (!lost)
+        memcpy(model, next, sizeof(model));
+    }
+
+    // Every power loss point has been covered once the run completes
+    if (!lost)
+      break;
+    nbPoints++;
+
+    Reboot();
+    nbNew = 0;
+    for (uint16_t key = 0; key < TEST_NB_KEYS; key++)
+    {
+      bool isInFlight = false;
+
+      for (uint8_t i = 0; i < nbInFlight; i++)
+        isInFlight = isInFlight || (inFlight[i] == key);
+
+      if (isInFlight && !Matches(key, &model[key]))
+      {
+        CHECK(Matches(key, &next[key]));
+        nbNew++;
+      }
+      else
+        CHECK(Matches(key, &model[key]));
+    }
+    CHECK((nbNew == 0) || (nbNew == nbInFlight) || (nbInFlight == 1));
+
+    // The store carries on after recovery
+    CHECK(WriteVersion(0, 0xFFFF, &model[0]));
+    Reboot();
+    CHECK(Matches(0, &model[0]));
+  }
+
+  printf("power loss: %lu points\n", (unsigned long)nbPoints);
+  CHECK(nbPoints > TEST_NB_OPERATIONS);
+}
+
+int main(void)
+{
+  TestBasic();
+  TestReboot();
+  TestWear();
+  TestCollect();
+  TestTornRecord();
+  TestPowerLoss();
+
+  printf("%lu checks, %lu failures\n", (unsigned long)NbChecks, (unsigned long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
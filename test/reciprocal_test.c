@@ -0,0 +1,105 @@
+/*! @file
+ *
+ *  @brief Tests of Reciprocal_Scale against a 64-bit divide.
+ *
+ *  For each module clock, Reciprocal_Scale(ns, Reciprocal_Init(clock, 1e9)) must equal (uint64_t)ns * clock / 1e9.
+ *  By default every RECIPROCAL_STRIDE-th input is checked, together with both sides of a sample of the points
+ *  where the result steps up, which is where rounding errors show first, and the ends of the range.
+ *  Run with the argument "exhaustive" to check all 2^32 inputs at every clock.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Reciprocal\reciprocal.h"
+
+#define NANOSECONDS_PER_SECOND 1000000000u
+
+// Inputs between checks in the strided run - odd, so every residue is reached across the clocks
+#define RECIPROCAL_STRIDE 251u
+
+// Result steps checked per clock in the strided run
+#define RECIPROCAL_NB_STEPS 1000000u
+
+// Inputs checked at each end of the range
+#define RECIPROCAL_NB_ENDS 65536u
+
+static const uint32_t Clocks[] =
+{
+  1u, 7u, 32768u, 1875000u, 50000000u, 60000000u, 120000000u, 999999999u, 1000000000u
+};
+
+static uint64_t NbChecks;
+static uint64_t NbFailures;
+
+/*! @brief Checks one input against the 64-bit divide, printing the first few mismatches.
+ */
+static void Check(const uint32_t ns, const uint32_t clock, const uint64_t reciprocal)
+{
+  uint32_t expected = (uint32_t)(((uint64_t)ns * clock) / NANOSECONDS_PER_SECOND);
+  uint32_t scaled = Reciprocal_Scale(ns, reciprocal);
+
+  NbChecks++;
+  if (scaled != expected)
+  {
+    if (NbFailures < 10)
+      printf("FAIL clock %lu, ns %lu: %lu, expected %lu\n",
+             (unsigned long)clock, (unsigned long)ns, (unsigned long)scaled, (unsigned long)expected);
+    NbFailures++;
+  }
+}
+
+/*! @brief Checks the inputs on both sides of the points where the result steps up.
+ */
+static void CheckSteps(const uint32_t clock, const uint64_t reciprocal)
+{
+  uint64_t maxTicks = ((uint64_t)UINT32_MAX * clock) / NANOSECONDS_PER_SECOND;
+  uint64_t step = maxTicks / RECIPROCAL_NB_STEPS + 1;
+  uint64_t ns;
+
+  for (uint64_t ticks = 1; ticks <= maxTicks; ticks += step)
+  {
+    // The first input that scales to ticks
+    ns = (ticks * NANOSECONDS_PER_SECOND + clock - 1) / clock;
+    Check((uint32_t)ns, clock, reciprocal);
+    Check((uint32_t)(ns - 1), clock, reciprocal);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bool exhaustive = (argc > 1) && (strcmp(argv[1], "exhaustive") == 0);
+  uint32_t stride = exhaustive ? 1 : RECIPROCAL_STRIDE;
+  uint64_t reciprocal;
+
+  for (uint8_t index = 0; index < sizeof(Clocks) / sizeof(Clocks[0]); index++)
+  {
+    reciprocal = Reciprocal_Init(Clocks[index], NANOSECONDS_PER_SECOND);
+
+    for (uint64_t ns = index % stride; ns <= UINT32_MAX; ns += stride)
+      Check((uint32_t)ns, Clocks[index], reciprocal);
+
+    for (uint32_t ns = 0; ns < RECIPROCAL_NB_ENDS; ns++)
+    {
+      Check(ns, Clocks[index], reciprocal);
+      Check(UINT32_MAX - ns, Clocks[index], reciprocal);
+    }
+
+    CheckSteps(Clocks[index], reciprocal);
+  }
+
+  printf("%s: %llu checks, %llu failures\n", exhaustive ? "exhaustive" : "strided",
+         (unsigned long long)NbChecks, (unsigned long long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
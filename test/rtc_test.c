@@ -0,0 +1,208 @@
+/*! @file
+ *
+ *  @brief Tests of the RTC calendar conversions.
+ *
+ *  RTC_ToCalendar is checked against a date that is stepped one day at a time from the epoch, and
+ *  RTC_FromCalendar must give back the original seconds. By default every day is checked at midnight, at
+ *  the last second and at one time of day that moves on by RTC_STRIDE seconds each day, together with
+ *  known dates at the leap days and the ends of the range.
+ *  Run with the argument "exhaustive" to check every second of the 32-bit range.
+ *
+ *  @author agent
+ *  @date 2026-10-19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RTC\RTC.h"
+#include "MK64F12.h"
+
+#define SECONDS_PER_DAY 86400u
+
+// Days from the epoch to the last day the 32-bit counter reaches, 2106-02-07
+#define LAST_DAY (UINT32_MAX / SECONDS_PER_DAY)
+
+// Time of day step between days in the default run - prime, so every time of day is reached across the range
+#define RTC_STRIDE 7919u
+
+// The registers the stand-in device header declares
+RTC_Type RTCRegs;
+SIM_Type SIMRegs;
+
+/*!
+ * @struct TTestDate
+ *  A date and time with its seconds since the epoch.
+ */
+typedef struct
+{
+  uint32_t seconds;
+  TRTCCalendar calendar;
+} TTestDate;
+
+static const TTestDate KnownDates[] =
+{
+  {0u,          {1970, 1, 1, 0, 0, 0, 4}},
+  {951782400u,  {2000, 2, 29, 0, 0, 0, 2}},
+  {4107542399u, {2100, 2, 28, 23, 59, 59, 0}},
+  {4107542400u, {2100, 3, 1, 0, 0, 0, 1}},
+  {4294967295u, {2106, 2, 7, 6, 28, 15, 0}}
+};
+
+static uint64_t NbChecks;
+static uint64_t NbFailures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+/*! @brief Records the result of a check, printing the first few failures.
+ */
+static void Check(const bool passed, const char* const text, const int line)
+{
+  NbChecks++;
+  if (!passed)
+  {
+    if (NbFailures < 10)
+      printf("FAIL line %d: %s\n", line, text);
+    NbFailures++;
+  }
+}
+
+/*! @brief Checks whether two calendar times are the same, including the weekday.
+ */
+static bool SameCalendar(const TRTCCalendar* const a, const TRTCCalendar* const b)
+{
+  return (a->year == b->year) && (a->month == b->month) && (a->day == b->day) && (a->hours == b->hours)
+         && (a->minutes == b->minutes) && (a->seconds == b->seconds) && (a->weekday == b->weekday);
+}
+
+/*! @brief Checks that a second converts to the expected calendar time and back.
+ */
+static void CheckSecond(const uint32_t seconds, const TRTCCalendar* const expected)
+{
+  TRTCCalendar calendar;
+  uint32_t back = 0;
+
+  RTC_ToCalendar(seconds, &calendar);
+  CHECK(SameCalendar(&calendar, expected));
+  CHECK(RTC_FromCalendar(&calendar, &back) && (back == seconds));
+}
+
+/*! @brief Checks one time of day on a day.
+ */
+static void CheckTimeOfDay(const uint32_t day, const uint32_t timeOfDay, TRTCCalendar* const date)
+{
+  date->hours = (uint8_t)(timeOfDay / 3600);
+  date->minutes = (uint8_t)((timeOfDay / 60) % 60);
+  date->seconds = (uint8_t)(timeOfDay % 60);
+  CheckSecond(day * SECONDS_PER_DAY + timeOfDay, date);
+}
+
+/*! @brief Steps a date on by one day.
+ */
+static void NextDay(TRTCCalendar* const date)
+{
+  static const uint8_t DaysInMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = ((date->year % 4 == 0) && (date->year % 100 != 0)) || (date->year % 400 == 0);
+
+  date->weekday = (uint8_t)((date->weekday + 1) % 7);
+  if (date->day < DaysInMonth[date->month - 1] + ((date->month == 2) && leap ? 1 : 0))
+    date->day++;
+  else if (date->month < 12)
+  {
+    date->day = 1;
+    date->month++;
+  }
+  else
+  {
+    date->day = 1;
+    date->month = 1;
+    date->year++;
+  }
+}
+
+/*! @brief Round trips the whole range, one day at a time.
+ *
+ *  @param exhaustive TRUE to check every second of each day.
+ */
+static void TestRange(const bool exhaustive)
+{
+  TRTCCalendar date = {1970, 1, 1, 0, 0, 0, 4};
+  uint32_t lastSecond;
+
+  for (uint32_t day = 0; day <= LAST_DAY; day++)
+  {
+    // The counter stops part way through the last day
+    lastSecond = (day == LAST_DAY) ? UINT32_MAX % SECONDS_PER_DAY : SECONDS_PER_DAY - 1;
+
+    if (exhaustive)
+    {
+      for (uint32_t timeOfDay = 0; timeOfDay <= lastSecond; timeOfDay++)
+        CheckTimeOfDay(day, timeOfDay, &date);
+    }
+    else
+    {
+      CheckTimeOfDay(day, 0, &date);
+      CheckTimeOfDay(day, ((uint64_t)day * RTC_STRIDE) % (lastSecond + 1), &date);
+      CheckTimeOfDay(day, lastSecond, &date);
+    }
+
+    NextDay(&date);
+  }
+}
+
+/*! @brief Checks the leap days and the ends of the range.
+ */
+static void TestKnownDates(void)
+{
+  for (size_t i = 0; i < sizeof(KnownDates) / sizeof(KnownDates[0]); i++)
+    CheckSecond(KnownDates[i].seconds, &KnownDates[i].calendar);
+}
+
+/*! @brief Checks that dates outside the calendar or the range of the counter are rejected.
+ */
+static void TestInvalid(void)
+{
+  static const TRTCCalendar Invalid[] =
+  {
+    {1969, 12, 31, 23, 59, 59, 0},
+    {2106, 2, 7, 6, 28, 16, 0},
+    {2107, 1, 1, 0, 0, 0, 0},
+    {2100, 2, 29, 0, 0, 0, 0},
+    {2001, 2, 29, 0, 0, 0, 0},
+    {2000, 4, 31, 0, 0, 0, 0},
+    {2000, 0, 1, 0, 0, 0, 0},
+    {2000, 13, 1, 0, 0, 0, 0},
+    {2000, 1, 0, 0, 0, 0, 0},
+    {2000, 1, 1, 24, 0, 0, 0},
+    {2000, 1, 1, 0, 60, 0, 0},
+    {2000, 1, 1, 0, 0, 60, 0}
+  };
+  uint32_t seconds;
+
+  for (size_t i = 0; i < sizeof(Invalid) / sizeof(Invalid[0]); i++)
+  {
+    seconds = 12345;
+    CHECK(!RTC_FromCalendar(&Invalid[i], &seconds) && (seconds == 12345));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bool exhaustive = (argc > 1) && (strcmp(argv[1], "exhaustive") == 0);
+
+  TestKnownDates();
+  TestInvalid();
+  TestRange(exhaustive);
+
+  printf("%s: %llu checks, %llu failures\n", exhaustive ? "exhaustive" : "strided",
+         (unsigned long long)NbChecks, (unsigned long long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,19 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the critical section macros.
+ *
+ *  Host programs run the interrupt callbacks from the main thread, so there is nothing to mask.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef CRITICAL_H
+#define CRITICAL_H
+
+#define EnterCritical()
+#define ExitCritical()
+#define EnterCriticalCeiling()
+#define ExitCriticalCeiling()
+
+#endif
@@ -0,0 +1,68 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the device header, covering the registers used by the RTC module.
+ *
+ *  The RTC registers are a plain struct in RAM, defined by the test program.
+ *  The NVIC functions do nothing.
+ *
+ *  @author agent
+ *  @date 2026-10-19
+ */
+
+#ifndef MK64F12_H
+#define MK64F12_H
+
+#include <stdint.h>
+
+/*!
+ * @struct RTC_Type
+ *  The RTC registers, in the order of the device header.
+ */
+typedef struct
+{
+  volatile uint32_t TSR;
+  volatile uint32_t TPR;
+  volatile uint32_t TAR;
+  volatile uint32_t TCR;
+  volatile uint32_t CR;
+  volatile uint32_t SR;
+  volatile uint32_t LR;
+  volatile uint32_t IER;
+} RTC_Type;
+
+/*!
+ * @struct SIM_Type
+ *  The clock gate register used by the RTC module.
+ */
+typedef struct
+{
+  volatile uint32_t SCGC6;
+} SIM_Type;
+
+extern RTC_Type RTCRegs;
+extern SIM_Type SIMRegs;
+
+#define RTC (&RTCRegs)
+#define SIM (&SIMRegs)
+
+#define SIM_SCGC6_RTC_MASK 0x20000000U
+
+#define RTC_CR_SC2P_MASK  0x2000U
+#define RTC_CR_SC8P_MASK  0x0400U
+#define RTC_CR_OSCE_MASK  0x0100U
+#define RTC_SR_TIF_MASK   0x01U
+#define RTC_SR_TOF_MASK   0x02U
+#define RTC_SR_TAF_MASK   0x04U
+#define RTC_SR_TCE_MASK   0x10U
+#define RTC_LR_CRL_MASK   0x10U
+#define RTC_IER_TAIE_MASK 0x04U
+#define RTC_IER_TSIE_MASK 0x10U
+
+#define RTC_IRQn         46
+#define RTC_Seconds_IRQn 47
+
+#define NVIC_SetPriority(irq, priority) ((void)(irq))
+#define NVIC_ClearPendingIRQ(irq)       ((void)(irq))
+#define NVIC_EnableIRQ(irq)             ((void)(irq))
+
+#endif
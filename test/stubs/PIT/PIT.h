@@ -0,0 +1,23 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the PIT module.
+ *
+ *  Declares the PIT functions used by the code under test. The test program defines them,
+ *  so it can call the channel callback as the interrupt would and control the lifetime timer.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef PIT_H
+#define PIT_H
+
+// new types
+#include "Types\types.h"
+
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments);
+bool PIT_Set(const uint8_t channelNb, const uint32_t period, const bool restart);
+bool PIT_Enable(const uint8_t channelNb, const bool enable);
+uint64_t PIT_LifetimeNanoseconds(void);
+
+#endif
@@ -0,0 +1,20 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the SDK power mode driver.
+ *
+ *  Wait mode returns at once, since the test program moves the simulated time itself.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#ifndef FSL_SMC_H
+#define FSL_SMC_H
+
+#define SMC NULL
+
+#define SMC_PreEnterWaitModes()
+#define SMC_SetPowerModeWait(base) 0
+#define SMC_PostExitWaitModes()
+
+#endif
@@ -0,0 +1,179 @@
+/*! @file
+ *
+ *  @brief Benchmark of the timer wheel with 10000 active timers.
+ *
+ *  Periodic timers with delays and periods spread over all levels of the wheel are started,
+ *  the wheel is ticked until every level has cascaded, and then every timer is cancelled.
+ *  Each callback checks that it runs on the tick it is due, and the host time per operation is printed.
+ *  The PIT is stubbed: the channel callback is called directly in place of the interrupt.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "TimerWheel\TimerWheel.h"
+
+// Number of timers running at once
+#define BENCH_NB_TIMERS 10000
+
+// Delays are spread up to this many ticks, and the wheel is ticked for twice as long
+#define BENCH_MAX_DELAY  (1u << 24)
+#define BENCH_NB_TICKS   (2u * BENCH_MAX_DELAY)
+
+// Range of periods, which sets the number of expiries
+#define BENCH_MIN_PERIOD (1u << 12)
+#define BENCH_MAX_PERIOD (1u << 20)
+
+#if TIMERWHEEL_NB_TIMERS < BENCH_NB_TIMERS
+#error "Build with TIMERWHEEL_NB_TIMERS of at least BENCH_NB_TIMERS"
+#endif
+
+/*!
+ * @struct TBenchTimer
+ */
+typedef struct
+{
+  TTimerWheelHandle handle;  /*!< The running timer */
+  uint32_t due;              /*!< The tick of the next expiry */
+  uint32_t period;           /*!< The ticks between expiries */
+} TBenchTimer;
+
+static TBenchTimer BenchTimers[BENCH_NB_TIMERS];
+
+static void (*TickFunction)(void*);
+static void* TickArguments;
+
+static uint32_t NbExpiries;
+static uint32_t NbLate;
+
+static uint32_t Random;
+
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments)
+{
+  TickFunction = userFunction;
+  TickArguments = userArguments;
+  return true;
+}
+
+bool PIT_Set(const uint8_t channelNb, const uint32_t period, const bool restart)
+{
+  return true;
+}
+
+bool PIT_Enable(const uint8_t channelNb, const bool enable)
+{
+  return true;
+}
+
+uint64_t PIT_LifetimeNanoseconds(void)
+{
+  return 0;
+}
+
+/*! @brief Gets the next pseudo-random number.
+ */
+static uint32_t NextRandom(void)
+{
+  Random = Random * 1664525u + 1013904223u;
+  return Random >> 8;
+}
+
+/*! @brief Gets a delay with a log-uniform spread up to BENCH_MAX_DELAY, so every level of the wheel is used.
+ */
+static uint32_t RandomDelay(void)
+{
+  uint32_t bits = 1 + NextRandom() % 24;
+
+  return 1 + NextRandom() % (1u << bits);
+}
+
+/*! @brief Gets a period from BENCH_MIN_PERIOD to BENCH_MAX_PERIOD.
+ */
+static uint32_t RandomPeriod(void)
+{
+  return BENCH_MIN_PERIOD + NextRandom() % (BENCH_MAX_PERIOD - BENCH_MIN_PERIOD + 1);
+}
+
+/*! @brief Gets the host time in nanoseconds.
+ */
+static uint64_t HostTime(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/*! @brief Checks that a timer expires on the tick it is due.
+ */
+static void Expired(void* arguments)
+{
+  TBenchTimer* timer = (TBenchTimer*)arguments;
+
+  if (TimerWheel_Now() != timer->due)
+    NbLate++;
+
+  timer->due += timer->period;
+  NbExpiries++;
+}
+
+int main(void)
+{
+  uint64_t start, startTime, tickTime, cancelTime;
+  uint32_t nbExpiries, nbCancelled = 0;
+
+  if (!TimerWheel_Init(2, 1000000))
+  {
+    printf("init failed\n");
+    return EXIT_FAILURE;
+  }
+
+  start = HostTime();
+  for (uint32_t i = 0; i < BENCH_NB_TIMERS; i++)
+  {
+    uint32_t delay = RandomDelay();
+
+    BenchTimers[i].due = TimerWheel_Now() + delay;
+    BenchTimers[i].period = RandomPeriod();
+    BenchTimers[i].handle = TimerWheel_Start(delay, BenchTimers[i].period, Expired, &BenchTimers[i]);
+  }
+  startTime = HostTime() - start;
+
+  start = HostTime();
+  for (uint32_t tick = 0; tick < BENCH_NB_TICKS; tick++)
+    TickFunction(TickArguments);
+  tickTime = HostTime() - start;
+  nbExpiries = NbExpiries;
+
+  start = HostTime();
+  for (uint32_t i = 0; i < BENCH_NB_TIMERS; i++)
+  {
+    if (TimerWheel_Cancel(BenchTimers[i].handle))
+      nbCancelled++;
+  }
+  cancelTime = HostTime() - start;
+
+  // No callbacks once every timer is cancelled, and stale handles are rejected
+  NbExpiries = 0;
+  for (uint32_t tick = 0; tick < BENCH_MAX_DELAY; tick++)
+    TickFunction(TickArguments);
+
+  printf("%u timers, %u ticks, %lu expiries\n", BENCH_NB_TIMERS, BENCH_NB_TICKS, (unsigned long)nbExpiries);
+  printf("start %.1f ns, tick %.1f ns including expiries, cancel %.1f ns\n",
+         (double)startTime / BENCH_NB_TIMERS, (double)tickTime / BENCH_NB_TICKS, (double)cancelTime / BENCH_NB_TIMERS);
+
+  if (NbLate || (nbCancelled != BENCH_NB_TIMERS) || NbExpiries || TimerWheel_Cancel(BenchTimers[0].handle))
+  {
+    printf("late %lu, cancelled %lu, expiries after cancel %lu\n",
+           (unsigned long)NbLate, (unsigned long)nbCancelled, (unsigned long)NbExpiries);
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}
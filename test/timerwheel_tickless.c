@@ -0,0 +1,230 @@
+/*! @file
+ *
+ *  @brief Tests of the timer wheel in tickless mode.
+ *
+ *  The PIT is stubbed with a simulated lifetime timer and a one-channel deadline,
+ *  and the channel callback is called when the simulated time reaches the deadline, as the interrupt would be.
+ *  Covers timers started after the wheel has been idle for close to the 32-bit tick wrap,
+ *  periodic timers, and timers started while the interrupt for an earlier timer is held off.
+ *
+ *  @author agent
+ *  @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TimerWheel\TimerWheel.h"
+
+// Tick period in nanoseconds
+#define TEST_TICK 1000u
+
+/*!
+ * @struct TTestTimer
+ */
+typedef struct
+{
+  uint64_t due;        /*!< The lifetime tick of the next expiry */
+  uint32_t period;     /*!< The ticks between expiries */
+  uint32_t count;      /*!< Number of expiries */
+  uint32_t nbLate;     /*!< Expiries after the tick they were due on */
+} TTestTimer;
+
+static uint64_t Time;       // Simulated lifetime timer in nanoseconds
+static uint64_t Deadline;   // When the channel next times out
+static uint32_t Period;
+static bool Armed;
+
+static void (*TickFunction)(void*);
+static void* TickArguments;
+
+static uint32_t NbChecks;
+static uint32_t NbFailures;
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+/*! @brief Records the result of a check, printing it if it failed.
+ */
+static void Check(const bool passed, const char* const text, const int line)
+{
+  NbChecks++;
+  if (!passed)
+  {
+    NbFailures++;
+    printf("FAIL line %d: %s\n", line, text);
+  }
+}
+
+bool PIT_SetCallback(const uint8_t channelNb, void (*userFunction)(void*), void* userArguments)
+{
+  TickFunction = userFunction;
+  TickArguments = userArguments;
+  return true;
+}
+
+bool PIT_Set(const uint8_t channelNb, const uint32_t period, const bool restart)
+{
+  Period = period;
+  Deadline = Time + period;
+  Armed = true;
+  return true;
+}
+
+bool PIT_Enable(const uint8_t channelNb, const bool enable)
+{
+  Armed = enable;
+  return true;
+}
+
+uint64_t PIT_LifetimeNanoseconds(void)
+{
+  return Time;
+}
+
+/*! @brief Gets the lifetime timer in ticks.
+ */
+static uint64_t Ticks(void)
+{
+  return Time / TEST_TICK;
+}
+
+/*! @brief Runs the simulated time forward, calling the channel callback at each timeout.
+ */
+static void Run(const uint64_t ticks)
+{
+  uint64_t end = Time + ticks * TEST_TICK;
+
+  while (Armed && (Deadline <= end))
+  {
+    Time = Deadline;
+    Deadline += Period;
+    TickFunction(TickArguments);
+  }
+
+  Time = end;
+}
+
+/*! @brief Checks that the wheel expires a timer on the tick it is due, and counts late interrupts.
+ */
+static void Expired(void* arguments)
+{
+  TTestTimer* timer = (TTestTimer*)arguments;
+
+  CHECK(TimerWheel_Now() == (uint32_t)timer->due);
+  if (Ticks() != timer->due)
+    timer->nbLate++;
+
+  timer->due += timer->period;
+  timer->count++;
+}
+
+/*! @brief Starts a timer and records when it is due.
+ */
+static TTimerWheelHandle Start(TTestTimer* const timer, const uint32_t delay, const uint32_t period)
+{
+  timer->due = Ticks() + delay;
+  timer->period = period;
+  timer->count = 0;
+  timer->nbLate = 0;
+  return TimerWheel_Start(delay, period, Expired, timer);
+}
+
+/*! @brief Starts from tick 0 with no timers.
+ */
+static void Fresh(void)
+{
+  Time = 0;
+  Armed = false;
+  CHECK(TimerWheel_Init(2, TEST_TICK));
+}
+
+static void TestIdle(void)
+{
+  TTestTimer timer;
+
+  // Idle up to and past the wrap of the tick count
+  for (uint64_t idle = 0xFFFFFF00u; idle < 0x100000100u; idle += 0x40)
+  {
+    Fresh();
+    Run(idle);
+    CHECK(!Armed);
+    CHECK(TimerWheel_Now() == (uint32_t)idle);
+
+    CHECK(Start(&timer, 0x200, 0) != TIMERWHEEL_INVALID_HANDLE);
+    Run(0x1FF);
+    CHECK(timer.count == 0);
+    Run(1);
+    CHECK(timer.count == 1);
+    CHECK(timer.nbLate == 0);
+    Run(0x1000);
+    CHECK(timer.count == 1);
+    CHECK(!Armed);
+  }
+
+  // The longest delay, with the expiry past the wrap of the tick count
+  Fresh();
+  Run(0xC0000005u);
+  CHECK(Start(&timer, TIMERWHEEL_MAX_DELAY, 0) != TIMERWHEEL_INVALID_HANDLE);
+  Run(TIMERWHEEL_MAX_DELAY - 1);
+  CHECK(timer.count == 0);
+  Run(1);
+  CHECK((timer.count == 1) && (timer.nbLate == 0));
+}
+
+static void TestPeriodic(void)
+{
+  TTestTimer fast, slow;
+
+  Fresh();
+  Run(12345);
+  CHECK(Start(&fast, 7, 1000) != TIMERWHEEL_INVALID_HANDLE);
+  CHECK(Start(&slow, 100000, 250000) != TIMERWHEEL_INVALID_HANDLE);
+  Run(10000000);
+  CHECK(fast.count == 10000);
+  CHECK(slow.count == 40);
+  CHECK((fast.nbLate == 0) && (slow.nbLate == 0));
+}
+
+static void TestHeldOff(void)
+{
+  TTestTimer first, second;
+  TTimerWheelHandle handle;
+
+  Fresh();
+  Run(500);
+  CHECK(Start(&first, 10, 0) != TIMERWHEEL_INVALID_HANDLE);
+
+  // The interrupt is held off past the first timer - the count stops just short of it
+  Time += 20 * TEST_TICK;
+  CHECK(TimerWheel_Now() == (uint32_t)(first.due - 1));
+
+  handle = Start(&second, 5, 0);
+  CHECK(handle != TIMERWHEEL_INVALID_HANDLE);
+
+  // The first timer runs late but still sees the tick it was due on
+  TickFunction(TickArguments);
+  CHECK((first.count == 1) && (first.nbLate == 1));
+  CHECK(TimerWheel_Now() == (uint32_t)Ticks());
+
+  Run(5);
+  CHECK((second.count == 1) && (second.nbLate == 0));
+  CHECK(!TimerWheel_Cancel(handle));
+  CHECK(!Armed);
+}
+
+int main(void)
+{
+  TestIdle();
+  TestPeriodic();
+  TestHeldOff();
+
+  printf("%lu checks, %lu failures\n", (unsigned long)NbChecks, (unsigned long)NbFailures);
+  if (NbFailures)
+  {
+    printf("FAIL\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("PASS\n");
+  return EXIT_SUCCESS;
+}